@@ -0,0 +1,55 @@
+# if !defined( __palmira_ranker_hpp__ )
+# define __palmira_ranker_hpp__
+# include "structo/queries.hpp"
+# include <mtc/interfaces.h>
+# include <cstdint>
+# include <cstddef>
+
+namespace palmira {
+
+ /*
+  * IRanker
+  *
+  * Ranking function loaded from the plugin declared in the 'rankers' section of the
+  * service configuration and selected by the search 'ranker' argument:
+  *
+  *   "rankers": [
+  *     { "name": "bm25f", "module": "./libranker-bm25f.so", "config": "bm25f.json" }
+  *   ]
+  *
+  * The plugin exports the function of CreateRankerFn prototype named CreateRanker.
+  *
+  * The collectors buffer the documents matched and call Score() for the blocks of
+  * up to 64 documents, so the plugin call is paid per block.  The abstracts passed
+  * are the copies limited as the quoted ones are, valid for the call only.
+  * Score() is called concurrently by the parallel collectors.
+  */
+  struct IRanker: public mtc::Iface
+  {
+    using Abstract = structo::queries::Abstract;
+
+    struct Document
+    {
+      uint32_t        id;
+      const Abstract* tuples;
+    };
+
+   /*
+    * Score( docs, count, weights )
+    *
+    * Sets the weights of the documents passed, greater is better
+    */
+    virtual void  Score( const Document*, size_t count, double* weights ) = 0;
+  };
+
+ /*
+  * CreateRanker( output, config )
+  *
+  * Creates the ranker by the configuration file path passed, may be empty;
+  * returns 0 on success or the errno-compatible error code.
+  */
+  using CreateRankerFn = int( IRanker**, const char* );
+
+}
+
+# endif   // !__palmira_ranker_hpp__
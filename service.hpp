@@ -3,6 +3,8 @@
 # include "DeliriX/DOM-text.hpp"
 # include <mtc/interfaces.h>
 # include <mtc/zmap.h>
+# include <vector>
+# include <deque>
 
 namespace palmira {
 
@@ -78,6 +80,8 @@ namespace palmira {
     mtc::zval   query;
     mtc::zmap   order;
     mtc::zmap   terms;
+    mtc::zmap   filter;     // metadata predicate over the doc-values fields
+    mtc::zmap   facets;     // facet counters over the doc-values fields
 
     SearchArgs() = default;
     SearchArgs( const mtc::zval& req, const mtc::zmap& ord = {}, const mtc::zmap& tms = {} ):
@@ -86,6 +90,21 @@ namespace palmira {
       terms( tms )  {}
   };
 
+  struct MSearchArgs: TimingArgs
+  {
+    std::vector<SearchArgs> search;   // the batch timeout applies to the searches having no own one
+
+    MSearchArgs() = default;
+    MSearchArgs( const std::vector<SearchArgs>& req ): search( req ) {}
+  };
+
+  struct BulkArgs: TimingArgs
+  {
+    std::deque<InsertArgs>  insert;   // not moved on emplace_back, each keeps it's own document
+
+    BulkArgs() = default;
+  };
+
   struct IService: mtc::Iface
   {
     struct IPending;
@@ -95,6 +114,8 @@ namespace palmira {
     virtual auto  Update( const UpdateArgs&, NotifyFn = []( const mtc::zmap& ){} ) -> mtc::api<IPending> = 0;
     virtual auto  Remove( const RemoveArgs&, NotifyFn = []( const mtc::zmap& ){} ) -> mtc::api<IPending> = 0;
     virtual auto  Search( const SearchArgs&, NotifyFn = []( const mtc::zmap& ){} ) -> mtc::api<IPending> = 0;
+    virtual auto  MSearch( const MSearchArgs&, NotifyFn = []( const mtc::zmap& ){} ) -> mtc::api<IPending> = 0;
+    virtual auto  BulkInsert( const BulkArgs&, NotifyFn = []( const mtc::zmap& ){} ) -> mtc::api<IPending> = 0;
     virtual void  Commit() = 0;
   };
 
@@ -3,17 +3,41 @@
 # include "structo/context/processor.hpp"
 # include "structo/context/x-contents.hpp"
 # include "service.hpp"
+# include "ranker.hpp"
 # include <mtc/config.h>
+# include <string>
+# include <map>
 
 namespace palmira {
 
   using namespace structo;
 
+  class Executor;
+  class SearchCache;
+  class DocValues;
+
   using FnContents = std::function<context::Contents(
     const mtc::span<const mtc::span<const context::Lexeme>>&,
     const mtc::span<const DeliriX::MarkupTag>&,
     FieldHandler& )>;
 
+  using Rankers = std::map<std::string, mtc::api<IRanker>>;
+
+ /*
+  * Compression
+  *
+  * The quotation images codec: 'none', 'zlib', 'lz4' or 'zstd'; the zstd images may
+  * be compressed with the dictionary trained by the first images indexed.  The
+  * zlib images keep the legacy format readable by the older builds.
+  */
+  struct Compression
+  {
+    std::string codec = "zlib";
+    int         level = 0;          // 0 - the codec default
+    size_t      samples = 0;        // images sampled to train the zstd dictionary, 0 - no dictionary
+    size_t      dictlen = 0x10000;  // the dictionary size
+  };
+
   class StructoService
   {
     class data;
@@ -24,6 +48,11 @@ namespace palmira {
     auto  Set( context::Processor&& )     -> StructoService&;
     auto  Set( const context::Processor& ) -> StructoService&;
     auto  Set( const context::FieldManager& ) -> StructoService&;
+    auto  Set( std::shared_ptr<Executor> ) -> StructoService&;
+    auto  Set( std::shared_ptr<SearchCache> ) -> StructoService&;
+    auto  Set( std::shared_ptr<DocValues> ) -> StructoService&;
+    auto  Set( const Rankers& )           -> StructoService&;
+    auto  Set( const Compression& )       -> StructoService&;
 
   public:
     auto  Create() -> mtc::api<IService>;
@@ -16,6 +16,8 @@ namespace grpcapi
     auto  Update( const palmira::UpdateArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Remove( const palmira::RemoveArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Search( const palmira::SearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  MSearch( const palmira::MSearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  BulkInsert( const palmira::BulkArgs&, NotifyFn ) -> mtc::api<IPending> override;
     void  Commit() override {}
 
     Client( std::shared_ptr<grpc::Channel> channel );
@@ -116,6 +118,16 @@ namespace grpcapi
     return nullptr;
   }
 
+  auto  Client::MSearch( const palmira::MSearchArgs& args, NotifyFn notf ) -> mtc::api<IPending>
+  {
+    return nullptr;
+  }
+
+  auto  Client::BulkInsert( const palmira::BulkArgs& args, NotifyFn notf ) -> mtc::api<IPending>
+  {
+    return nullptr;
+  }
+
   Client::Client( std::shared_ptr<grpc::Channel> channel ):
     callStub( grpcttp::Search::NewStub( channel ) )
   {
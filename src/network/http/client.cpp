@@ -34,6 +34,8 @@ namespace remoapi
     auto  Update( const palmira::UpdateArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Remove( const palmira::RemoveArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Search( const palmira::SearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  MSearch( const palmira::MSearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  BulkInsert( const palmira::BulkArgs&, NotifyFn ) -> mtc::api<IPending> override;
     void  Commit() override {}
 
     void  SetChannel( const http::Channel& newChannel ) {  channel = newChannel;  }
@@ -227,6 +229,39 @@ namespace remoapi
     return std::move( *MakeContents( header, req ).Serialize( &serial ) );
   }
 
+  auto  MakeContents( const palmira::MSearchArgs& req ) -> std::vector<char>
+  {
+    mtc::zmap         header;
+    std::vector<char> serial;
+
+    return std::move( *MakeContents( header, req ).Serialize( &serial ) );
+  }
+
+ /*
+  * The documents of the batch are passed as the text dumps of the zmaps:
+  *   { "documents": [ { "id": ..., "metadata": ..., "dump": [ text dump ] }, ... ] }
+  */
+  auto  MakeContents( const palmira::BulkArgs& req ) -> std::vector<char>
+  {
+    mtc::zmap         header;
+    mtc::array_zmap   insert;
+    std::vector<char> serial;
+
+    for ( auto& next: req.insert )
+    {
+      auto  zmap = mtc::zmap();
+      auto  dump = std::vector<char>();
+
+      next.textview.Serialize( &dump );
+      MakeContents( zmap, (const palmira::UpdateArgs&)next )["dump"] = std::move( dump );
+      insert.push_back( std::move( zmap ) );
+    }
+
+    header["documents"] = std::move( insert );
+
+    return std::move( *MakeContents( header, (const palmira::TimingArgs&)req ).Serialize( &serial ) );
+  }
+
   // ClientAPI implementation
 
   template <class Request>
@@ -282,6 +317,16 @@ namespace remoapi
     return Modify( args, "/search", notf );
   }
 
+  auto  Client::impl::MSearch( const palmira::MSearchArgs& args, NotifyFn notf ) -> mtc::api<IPending>
+  {
+    return Modify( args, "/msearch", notf );
+  }
+
+  auto  Client::impl::BulkInsert( const palmira::BulkArgs& args, NotifyFn notf ) -> mtc::api<IPending>
+  {
+    return Modify( args, "/bulk", notf );
+  }
+
   // Client implementation
 
   Client::Client()
@@ -46,6 +46,48 @@ namespace json    {
     return Search( arg, req, LoadJs( src ) );
   }
 
+ /*
+  * Loads the batch of searches:
+  *   { "timeout": ..., "searches": [ { search arguments }, ... ] }
+  */
+  auto  Load( palmira::MSearchArgs& arg, const http::Request& req, mtc::IByteStream* src ) -> palmira::MSearchArgs&
+  {
+    auto  jsn = LoadJs( src );
+    auto  pss = jsn.get_array_zmap( "searches" );
+
+    if ( pss == nullptr )
+      throw std::invalid_argument( "request contains no 'searches' array @" __FILE__ ":" LINE_STRING );
+
+    arg.fTimeout = jsn.get_double( "timeout", -1.0 );
+
+    for ( auto& next: *pss )
+      Search( arg.search.emplace_back(), req, next );
+
+    return arg;
+  }
+
+ /*
+  * Loads the batch of documents to be inserted:
+  *   { "timeout": ..., "documents": [ { "id": ..., "metadata": ..., "json"|"tags"|"zmap": document }, ... ] }
+  */
+  auto  Load( palmira::BulkArgs& arg, const http::Request& req, mtc::IByteStream* src ) -> palmira::BulkArgs&
+  {
+    auto  jsn = LoadJs( src );
+    auto  pdd = jsn.get_array_zmap( "documents" );
+
+    (void)req;
+
+    if ( pdd == nullptr )
+      throw std::invalid_argument( "request contains no 'documents' array @" __FILE__ ":" LINE_STRING );
+
+    arg.fTimeout = jsn.get_double( "timeout", -1.0 );
+
+    for ( auto& next: *pdd )
+      arg.insert.emplace_back( next );
+
+    return arg;
+  }
+
   template <class Args>
   auto  Access( Args& arg, const http::Request& req, const mtc::zmap& jsn ) -> Args&
   {
@@ -94,9 +136,36 @@ namespace json    {
     if ( get_id != "undefined" )
       return search.query = mtc::zmap{ { "id", get_id } }, search;
 
+    search.fTimeout = jsn.get_double( "timeout", -1.0 );
+
     search.order["first"] = jsn.get_int32( "first", 1 );
     search.order["count"] = jsn.get_int32( "count", 10 );
 
+    if ( jsn.get( "threads" ) != nullptr )
+      search.order["threads"] = jsn.get_int32( "threads", 0 );
+    if ( jsn.get( "quote_timeout" ) != nullptr )
+      search.order["quote_timeout"] = jsn.get_double( "quote_timeout", -1.0 );
+    if ( jsn.get_charstr( "after" ) != nullptr )
+      search.order["after"] = *jsn.get_charstr( "after" );
+    if ( jsn.get_charstr( "mode" ) != nullptr )
+      search.order["mode"] = *jsn.get_charstr( "mode" );
+    if ( jsn.get( "sort" ) != nullptr )
+      search.order["sort"] = *jsn.get( "sort" );
+    if ( jsn.get( "profile" ) != nullptr )
+      search.order["profile"] = jsn.get_bool( "profile", false );
+    if ( jsn.get_charstr( "group_by" ) != nullptr )
+      search.order["group_by"] = *jsn.get_charstr( "group_by" );
+    if ( jsn.get( "group_size" ) != nullptr )
+      search.order["group_size"] = jsn.get_int32( "group_size", 1 );
+    if ( jsn.get_charstr( "ranker" ) != nullptr )
+      search.order["ranker"] = *jsn.get_charstr( "ranker" );
+    if ( jsn.get_zmap( "rerank" ) != nullptr )
+      search.order["rerank"] = *jsn.get_zmap( "rerank" );
+    if ( jsn.get_zmap( "filter" ) != nullptr )
+      search.filter = *jsn.get_zmap( "filter" );
+    if ( jsn.get_zmap( "facets" ) != nullptr )
+      search.facets = *jsn.get_zmap( "facets" );
+
     if ( sz_req != nullptr )  search.query = structo::queries::ParseQuery( *sz_req );
       else
     if ( ws_req != nullptr )  search.query = structo::queries::ParseQuery( *ws_req );
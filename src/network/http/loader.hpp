@@ -13,6 +13,8 @@ namespace remoapi
     auto  Load( palmira::UpdateArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::UpdateArgs&;
     auto  Load( palmira::InsertArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::InsertArgs&;
     auto  Load( palmira::SearchArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::SearchArgs&;
+    auto  Load( palmira::MSearchArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::MSearchArgs&;
+    auto  Load( palmira::BulkArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::BulkArgs&;
   }
   namespace zmap
   {
@@ -21,6 +23,8 @@ namespace remoapi
     auto  Load( palmira::UpdateArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::UpdateArgs&;
     auto  Load( palmira::InsertArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::InsertArgs&;
     auto  Load( palmira::SearchArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::SearchArgs&;
+    auto  Load( palmira::MSearchArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::MSearchArgs&;
+    auto  Load( palmira::BulkArgs&, const http::Request&, mtc::IByteStream* ) -> palmira::BulkArgs&;
   }
 }
 
@@ -145,6 +145,10 @@ namespace remoapi
 
     server.RegisterHandler( "/search", http::Method::GET,   ActionCall<palmira::SearchArgs, &palmira::IService::Search>{ serach } );
     server.RegisterHandler( "/search", http::Method::POST,  ActionCall<palmira::SearchArgs, &palmira::IService::Search>{ serach } );
+
+    server.RegisterHandler( "/msearch", http::Method::POST, ActionCall<palmira::MSearchArgs, &palmira::IService::MSearch>{ serach } );
+
+    server.RegisterHandler( "/bulk", http::Method::POST,    ActionCall<palmira::BulkArgs, &palmira::IService::BulkInsert>{ serach } );
   }
 
   // helpers section
@@ -82,6 +82,29 @@ namespace zmap    {
     return arg;
   }
 
+  auto  Load( palmira::MSearchArgs& arg, const http::Request& req, mtc::IByteStream* src ) -> palmira::MSearchArgs&
+  {
+    return arg;
+  }
+
+  auto  Load( palmira::BulkArgs& arg, const http::Request& req, mtc::IByteStream* src ) -> palmira::BulkArgs&
+  {
+    auto  zmdata = ZmLoad( src );
+    auto  pdocs = zmdata.get_array_zmap( "documents" );
+
+    (void)req;
+
+    if ( pdocs == nullptr )
+      throw std::invalid_argument( "request contains no 'documents' array @" __FILE__ ":" LINE_STRING );
+
+    arg.fTimeout = zmdata.get_double( "timeout", -1.0 );
+
+    for ( auto& next: *pdocs )
+      arg.insert.emplace_back( next );
+
+    return arg;
+  }
+
   template <class Args>
   auto  Access( Args& arg, const http::Request& req, const mtc::zmap& jsn ) -> Args&
   {
@@ -0,0 +1,357 @@
+# include "bundle-zip.hpp"
+# include <stdexcept>
+# include <algorithm>
+# include <cstring>
+# include <zlib.h>
+# if defined( LZ4_ENABLED )
+#   include <lz4.h>
+# endif
+# if defined( ZSTD_ENABLED )
+#   include <zstd.h>
+#   include <zdict.h>
+# endif
+
+namespace palmira {
+
+  enum: size_t
+  {
+    image_version = 1,
+    header_length = 6,
+    zstd_defaults = 3     // ZSTD_CLEVEL_DEFAULT, static linking only in the older zstd
+  };
+
+ /*
+  * deflater
+  *
+  * The deflate stream of the thread being reset instead of allocated for each
+  * buffer compressed; re-created if the compression level changes
+  */
+  class deflater
+  {
+    z_stream  stream = {};
+    int       status = Z_STREAM_ERROR;
+    int       zlevel = 0;
+
+  public:
+   ~deflater()
+    {
+      if ( status == Z_OK )
+        deflateEnd( &stream );
+    }
+
+    auto  operator()( const mtc::span<const char>& src, char* out, size_t max, int level ) -> size_t
+    {
+      if ( status != Z_OK || zlevel != level )
+      {
+        if ( status == Z_OK )
+          deflateEnd( &stream );
+        stream = {};
+        status = deflateInit( &stream, zlevel = level );
+      }
+
+      if ( status != Z_OK || deflateReset( &stream ) != Z_OK )
+        throw std::range_error( "compression failed" );
+
+      stream.next_in = (Bytef*)src.data();
+      stream.avail_in = src.size();
+      stream.next_out = (Bytef*)out;
+      stream.avail_out = max;
+
+      if ( deflate( &stream, Z_FINISH ) != Z_STREAM_END )
+        throw std::range_error( "compression failed" );
+
+      return stream.total_out;
+    }
+    auto  bound( size_t length ) -> size_t
+    {
+      return compressBound( length );
+    }
+  };
+
+  static  thread_local deflater zipper;
+
+# if defined( ZSTD_ENABLED )
+  struct ZipDictionary::tables
+  {
+    ZSTD_CDict* cdict;
+    ZSTD_DDict* ddict;
+
+    tables( const std::vector<char>& buffer, int level ):
+      cdict( ZSTD_createCDict( buffer.data(), buffer.size(), level != 0 ? level : int(zstd_defaults) ) ),
+      ddict( ZSTD_createDDict( buffer.data(), buffer.size() ) ) {}
+   ~tables()
+    {
+      ZSTD_freeCDict( cdict );
+      ZSTD_freeDDict( ddict );
+    }
+  };
+
+  struct zstd_contexts
+  {
+    ZSTD_CCtx*  cctx = ZSTD_createCCtx();
+    ZSTD_DCtx*  dctx = ZSTD_createDCtx();
+
+   ~zstd_contexts()
+    {
+      ZSTD_freeCCtx( cctx );
+      ZSTD_freeDCtx( dctx );
+    }
+  };
+
+  static  thread_local zstd_contexts zstdctx;
+# else
+  struct ZipDictionary::tables {};
+# endif
+
+  // legacy images
+
+  auto  ZipBuf( const mtc::span<const char>& src, std::vector<char>& out, int level ) -> std::vector<char>&
+  {
+    out.resize( zipper.bound( src.size() ) );
+    out.resize( zipper( src, out.data(), out.size(), level != 0 ? level : Z_DEFAULT_COMPRESSION ) );
+
+    if ( out.size() > src.size() - 100 )
+      throw std::range_error( "ignore compression" );
+
+    return out;
+  }
+
+  auto  Unpack( const mtc::span<const char>& src ) -> std::vector<char>
+  {
+    std::vector<char> unpack( src.size() * 2 );
+    uLongf            length;
+    int               nerror;
+
+    while ( (nerror = uncompress( (Bytef*)unpack.data(), &(length = unpack.size()),
+      (const Bytef*)src.data(), src.size() )) == Z_BUF_ERROR )
+        unpack.resize( unpack.size() * 3 / 2 );
+
+    if ( nerror == Z_OK ) unpack.resize( length );
+      else unpack.clear();
+
+    return unpack;
+  }
+
+  // versioned images
+
+  auto  GetCodec( const std::string& name ) -> Codec
+  {
+    auto  codec =
+      name == "none" ? Codec::None :
+      name == "zlib" ? Codec::Zlib :
+      name == "lz4"  ? Codec::LZ4  :
+      name == "zstd" ? Codec::Zstd : throw std::invalid_argument( "unknown codec '" + name + "', 'none', 'zlib', 'lz4' or 'zstd' expected" );
+
+    if ( !IsSupported( codec ) )
+      throw std::invalid_argument( "codec '" + name + "' is not built, see LZ4_ENABLED and ZSTD_ENABLED options" );
+
+    return codec;
+  }
+
+  bool  IsSupported( Codec codec )
+  {
+    switch ( codec )
+    {
+      case Codec::None:
+      case Codec::Zlib:
+        return true;
+# if defined( LZ4_ENABLED )
+      case Codec::LZ4:
+        return true;
+# endif
+# if defined( ZSTD_ENABLED )
+      case Codec::Zstd:
+        return true;
+# endif
+      default:
+        return false;
+    }
+  }
+
+ /*
+  * PackImage( src, options, out )
+  *
+  * The image is stored uncompressed if the compression saves less than 100 bytes,
+  * as the legacy images were
+  */
+  auto  PackImage( const mtc::span<const char>& src, const ZipOptions& options, std::vector<char>& out ) -> std::vector<char>&
+  {
+    auto  output = (char*)nullptr;
+    auto  length = size_t(0);
+
+    if ( src.size() > uint32_t(-1) )
+      throw std::invalid_argument( "image is too long" );
+
+    switch ( options.codec )
+    {
+      case Codec::Zlib:
+        out.resize( header_length + zipper.bound( src.size() ) );
+        length = zipper( src, output = out.data() + header_length, out.size() - header_length,
+          options.level != 0 ? options.level : Z_DEFAULT_COMPRESSION );
+        break;
+# if defined( LZ4_ENABLED )
+      case Codec::LZ4:
+        out.resize( header_length + LZ4_compressBound( int(src.size()) ) );
+        length = size_t(std::max( LZ4_compress_default( src.data(), output = out.data() + header_length,
+          int(src.size()), int(out.size() - header_length) ), 0 ));
+        if ( length == 0 )
+          throw std::range_error( "compression failed" );
+        break;
+# endif
+# if defined( ZSTD_ENABLED )
+      case Codec::Zstd:
+        out.resize( header_length + ZSTD_compressBound( src.size() ) );
+        length = options.dicts != nullptr && options.dicts->ztable->cdict != nullptr ?
+          ZSTD_compress_usingCDict( zstdctx.cctx, output = out.data() + header_length, out.size() - header_length,
+            src.data(), src.size(), options.dicts->ztable->cdict ) :
+          ZSTD_compressCCtx( zstdctx.cctx, output = out.data() + header_length, out.size() - header_length,
+            src.data(), src.size(), options.level != 0 ? options.level : int(zstd_defaults) );
+        if ( ZSTD_isError( length ) )
+          throw std::range_error( "compression failed" );
+        break;
+# endif
+      case Codec::None:
+        break;
+      default:
+        throw std::invalid_argument( "codec is not built" );
+    }
+
+  // store uncompressed if not worth compressing
+    if ( output == nullptr || length + 100 > src.size() )
+    {
+      out.resize( header_length + src.size() );
+      std::memcpy( out.data() + header_length, src.data(), src.size() );
+      out[1] = char(Codec::None);
+    }
+      else
+    {
+      out.resize( header_length + length );
+      out[1] = char(options.codec);
+    }
+
+    out[0] = char(image_version);
+
+    for ( size_t i = 0; i != 4; ++i )
+      out[2 + i] = char(src.size() >> (i * 8));
+
+    return out;
+  }
+
+  auto  UnpackImage( const mtc::span<const char>& src, const ZipDictionary* dicts ) -> std::vector<char>
+  {
+    auto  output = std::vector<char>();
+    auto  length = size_t(0);
+    auto  ziplen = src.size() - header_length;
+    auto  zipped = src.data() + header_length;
+
+    if ( src.size() < header_length || uint8_t(src.data()[0]) != image_version )
+      throw std::runtime_error( "invalid quotation image version" );
+
+    for ( size_t i = 0; i != 4; ++i )
+      length |= size_t(uint8_t(src.data()[2 + i])) << (i * 8);
+
+    output.resize( length );
+
+    switch ( Codec(src.data()[1]) )
+    {
+      case Codec::None:
+        if ( ziplen != length )
+          throw std::runtime_error( "invalid quotation image length" );
+        std::memcpy( output.data(), zipped, length );
+        return output;
+
+      case Codec::Zlib:
+        {
+          auto  outlen = uLongf( length );
+
+          if ( uncompress( (Bytef*)output.data(), &outlen, (const Bytef*)zipped, ziplen ) != Z_OK || outlen != length )
+            throw std::runtime_error( "invalid zlib quotation image" );
+          return output;
+        }
+
+# if defined( LZ4_ENABLED )
+      case Codec::LZ4:
+        if ( LZ4_decompress_safe( zipped, output.data(), int(ziplen), int(length) ) != int(length) )
+          throw std::runtime_error( "invalid lz4 quotation image" );
+        return output;
+# endif
+
+# if defined( ZSTD_ENABLED )
+      case Codec::Zstd:
+        {
+          auto  dictId = ZSTD_getDictID_fromFrame( zipped, ziplen );
+          auto  outlen = size_t(0);
+
+          if ( dictId != 0 )
+          {
+            if ( dicts == nullptr || dicts->GetId() != dictId || dicts->ztable->ddict == nullptr )
+              throw std::runtime_error( "quotation image dictionary not found" );
+            outlen = ZSTD_decompress_usingDDict( zstdctx.dctx, output.data(), length, zipped, ziplen, dicts->ztable->ddict );
+          }
+            else
+          outlen = ZSTD_decompressDCtx( zstdctx.dctx, output.data(), length, zipped, ziplen );
+
+          if ( ZSTD_isError( outlen ) || outlen != length )
+            throw std::runtime_error( "invalid zstd quotation image" );
+          return output;
+        }
+# endif
+
+      default:
+        (void)dicts;
+        throw std::runtime_error( "quotation image codec is not built" );
+    }
+  }
+
+  // ZipDictionary implementation
+
+  ZipDictionary::ZipDictionary( const mtc::span<const char>& data, int level ):
+    buffer( data.begin(), data.end() )
+  {
+# if defined( ZSTD_ENABLED )
+    ztable = new tables( buffer, level );
+
+    if ( ztable->cdict == nullptr || ztable->ddict == nullptr || (dictId = ZDICT_getDictID( buffer.data(), buffer.size() )) == 0 )
+    {
+      delete ztable;
+      throw std::invalid_argument( "invalid zstd dictionary" );
+    }
+# else
+    (void)level;
+    throw std::invalid_argument( "zstd dictionaries are not built, see ZSTD_ENABLED option" );
+# endif
+  }
+
+  ZipDictionary::~ZipDictionary()
+  {
+    delete ztable;
+  }
+
+  auto  ZipDictionary::Train( const std::vector<std::vector<char>>& samples, size_t size ) -> std::vector<char>
+  {
+# if defined( ZSTD_ENABLED )
+    auto  sampled = std::vector<char>();
+    auto  lengths = std::vector<size_t>();
+    auto  trained = std::vector<char>( size );
+
+    for ( auto& next: samples )
+    {
+      sampled.insert( sampled.end(), next.begin(), next.end() );
+      lengths.push_back( next.size() );
+    }
+
+    size = ZDICT_trainFromBuffer( trained.data(), trained.size(),
+      sampled.data(), lengths.data(), unsigned(lengths.size()) );
+
+    if ( ZDICT_isError( size ) )
+      return {};
+
+    return trained.resize( size ), trained;
+# else
+    (void)samples;
+    (void)size;
+    return {};
+# endif
+  }
+
+}
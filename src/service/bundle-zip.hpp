@@ -0,0 +1,115 @@
+# if !defined( __palmira_src_service_bundle_zip_hpp__ )
+# define __palmira_src_service_bundle_zip_hpp__
+# include <mtc/span.hpp>
+# include <cstdint>
+# include <string>
+# include <vector>
+
+namespace palmira {
+
+ /*
+  * ZipBuf( src, out, level )
+  *
+  * Compresses the buffer to the output buffer reused; throws std::range_error if the
+  * buffer is not worth compressing.  The format of the legacy "ip" images, the level
+  * 0 is the zlib default.
+  */
+  auto  ZipBuf( const mtc::span<const char>&, std::vector<char>&, int level = 0 ) -> std::vector<char>&;
+
+ /*
+  * Unpack( src )
+  *
+  * Uncompresses the legacy "ip" image guessing it's length; returns empty buffer on error
+  */
+  auto  Unpack( const mtc::span<const char>& ) -> std::vector<char>;
+
+ /*
+  * The versioned quotation image, the "iz" bundle key:
+  *
+  *   version     1 byte, 1;
+  *   codec       1 byte, Codec;
+  *   length      4 bytes little-endian, the uncompressed length;
+  *   data        the image compressed by the codec.
+  *
+  * The images not worth compressing are stored by Codec::None.  The codecs other
+  * than zlib are built by the LZ4_ENABLED and ZSTD_ENABLED CMake options.  The
+  * images of the zlib compression are still stored as legacy "ip"/"im".
+  */
+  enum class Codec: uint8_t
+  {
+    None = 0,
+    Zlib = 1,
+    LZ4  = 2,
+    Zstd = 3
+  };
+
+  class ZipDictionary;
+
+  struct ZipOptions
+  {
+    Codec                 codec = Codec::Zlib;
+    int                   level = 0;              // 0 is the codec default
+    const ZipDictionary*  dicts = nullptr;        // zstd only, optional
+  };
+
+  auto  GetCodec( const std::string& ) -> Codec;
+  bool  IsSupported( Codec );
+
+ /*
+  * PackImage( src, options, out )
+  *
+  * Packs the image to the versioned format in the output buffer reused
+  */
+  auto  PackImage( const mtc::span<const char>&, const ZipOptions&, std::vector<char>& ) -> std::vector<char>&;
+
+ /*
+  * UnpackImage( src, dicts )
+  *
+  * Unpacks the versioned image to the length recorded; the zstd images compressed
+  * with the dictionary need the dictionary of the same id.  Throws std::runtime_error
+  * on invalid or unsupported images.
+  */
+  auto  UnpackImage( const mtc::span<const char>&, const ZipDictionary* = nullptr ) -> std::vector<char>;
+
+ /*
+  * ZipDictionary
+  *
+  * The zstd dictionary trained by the samples of the images; the compression and
+  * the decompression tables are prepared once and shared by the threads.
+  */
+  class ZipDictionary final
+  {
+    struct tables;
+
+  public:
+    ZipDictionary( const mtc::span<const char>&, int level = 0 );
+   ~ZipDictionary();
+
+    ZipDictionary( const ZipDictionary& ) = delete;
+    ZipDictionary& operator = ( const ZipDictionary& ) = delete;
+
+   /*
+    * Train( samples, size )
+    *
+    * Trains the dictionary of the size passed; returns empty buffer if the samples
+    * are not enough to train the dictionary
+    */
+    static  auto  Train( const std::vector<std::vector<char>>&, size_t ) -> std::vector<char>;
+
+  public:
+    auto  GetId() const -> uint32_t {  return dictId;  }
+    auto  GetData() const -> const std::vector<char>& {  return buffer;  }
+
+  protected:
+    friend auto  PackImage( const mtc::span<const char>&, const ZipOptions&, std::vector<char>& ) -> std::vector<char>&;
+    friend auto  UnpackImage( const mtc::span<const char>&, const ZipDictionary* ) -> std::vector<char>;
+
+    std::vector<char> buffer;
+    uint32_t          dictId = 0;
+    tables*           ztable = nullptr;
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_bundle_zip_hpp__
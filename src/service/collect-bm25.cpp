@@ -0,0 +1,258 @@
+# include "collect-bm25.hpp"
+# include <cstring>
+
+# if defined( __x86_64__ ) && defined( __GNUC__ )
+#   define BM25_X86_KERNELS
+#   include <immintrin.h>
+# endif
+
+// the weights have to be bit-identical for all the kernels, so no fused multiply-add
+# if defined( __clang__ )
+#   pragma clang fp contract( off )
+# elif defined( __GNUC__ )
+#   pragma GCC optimize( "fp-contract=off" )
+# endif
+
+namespace palmira {
+namespace collect {
+
+  // fdlibm log() constants
+
+  constexpr double  ln2_hi = 6.93147180369123816490e-01;
+  constexpr double  ln2_lo = 1.90821492927058770002e-10;
+  constexpr double  sqrt_2 = 1.41421356237309514547e+00;
+  constexpr double  e_bias = 4503599627371519.0;    // 2^52 + 1023
+  constexpr double  Lg1 = 6.666666666666735130e-01;
+  constexpr double  Lg2 = 3.999999999940941908e-01;
+  constexpr double  Lg3 = 2.857142874366239149e-01;
+  constexpr double  Lg4 = 2.222219843214978396e-01;
+  constexpr double  Lg5 = 1.818357216161805012e-01;
+  constexpr double  Lg6 = 1.531383769920937332e-01;
+  constexpr double  Lg7 = 1.479819860511658591e-01;
+
+  constexpr uint64_t  mantissa_bits = 0x000fffffffffffffULL;
+  constexpr uint64_t  one_exponent = 0x3ff0000000000000ULL;
+  constexpr uint64_t  big_exponent = 0x4330000000000000ULL;
+
+ /*
+  * Log( x )
+  *
+  * Natural logarithm of the positive normal x: x = m * 2^k, m in [sqrt(2)/2, sqrt(2)),
+  * log( m ) by the fdlibm polynomial.  The vector versions repeat the operations
+  * in the same order.
+  */
+  static  double  Log( double x )
+  {
+    uint64_t  bits;
+    double    m;
+    double    k;
+
+    memcpy( &bits, &x, sizeof(bits) );
+      bits = (bits >> 52) | big_exponent;
+    memcpy( &k, &bits, sizeof(k) );
+    memcpy( &bits, &x, sizeof(bits) );
+      bits = (bits & mantissa_bits) | one_exponent;
+    memcpy( &m, &bits, sizeof(m) );
+
+    k = k - e_bias;
+
+    if ( m >= sqrt_2 )
+      m = m * 0.5, k = k + 1.0;
+
+    auto  f = m - 1.0;
+    auto  s = f / (2.0 + f);
+    auto  z = s * s;
+    auto  w = z * z;
+    auto  r = z * (Lg1 + w * (Lg3 + w * (Lg5 + w * Lg7))) + w * (Lg2 + w * (Lg4 + w * Lg6));
+    auto  h = 0.5 * f * f;
+
+    return k * ln2_hi - ((h - (s * (h + r) + k * ln2_lo)) - f);
+  }
+
+  static  auto  ScoreScalar( const double* matrix, unsigned nterms, const double* nwords, double floor, double* weight ) -> uint32_t
+  {
+    uint32_t  output = 0;
+
+    for ( unsigned i = 0; i != BM25Block::block_size; ++i )
+    {
+      auto  product = 1.0;
+
+      for ( unsigned t = 0; t != nterms; ++t )
+        product = product * matrix[t * BM25Block::block_size + i];
+
+      if ( (weight[i] = BM25Block::Weight( product, nwords[i] )) >= floor )
+        output |= 1U << i;
+    }
+    return output;
+  }
+
+# if defined( BM25_X86_KERNELS )
+
+  static  auto  Log( __m128d x ) -> __m128d
+  {
+    auto  bits = _mm_castpd_si128( x );
+    auto  k = _mm_castsi128_pd( _mm_or_si128( _mm_srli_epi64( bits, 52 ), _mm_set1_epi64x( big_exponent ) ) );
+    auto  m = _mm_castsi128_pd( _mm_or_si128( _mm_and_si128( bits, _mm_set1_epi64x( mantissa_bits ) ), _mm_set1_epi64x( one_exponent ) ) );
+    auto  c = _mm_cmpge_pd( m, _mm_set1_pd( sqrt_2 ) );
+
+    k = _mm_sub_pd( k, _mm_set1_pd( e_bias ) );
+    m = _mm_or_pd( _mm_and_pd( c, _mm_mul_pd( m, _mm_set1_pd( 0.5 ) ) ), _mm_andnot_pd( c, m ) );
+    k = _mm_or_pd( _mm_and_pd( c, _mm_add_pd( k, _mm_set1_pd( 1.0 ) ) ), _mm_andnot_pd( c, k ) );
+
+    auto  f = _mm_sub_pd( m, _mm_set1_pd( 1.0 ) );
+    auto  s = _mm_div_pd( f, _mm_add_pd( _mm_set1_pd( 2.0 ), f ) );
+    auto  z = _mm_mul_pd( s, s );
+    auto  w = _mm_mul_pd( z, z );
+    auto  r = _mm_add_pd(
+      _mm_mul_pd( z, _mm_add_pd( _mm_set1_pd( Lg1 ), _mm_mul_pd( w, _mm_add_pd( _mm_set1_pd( Lg3 ), _mm_mul_pd( w,
+        _mm_add_pd( _mm_set1_pd( Lg5 ), _mm_mul_pd( w, _mm_set1_pd( Lg7 ) ) ) ) ) ) ) ),
+      _mm_mul_pd( w, _mm_add_pd( _mm_set1_pd( Lg2 ), _mm_mul_pd( w,
+        _mm_add_pd( _mm_set1_pd( Lg4 ), _mm_mul_pd( w, _mm_set1_pd( Lg6 ) ) ) ) ) ) );
+    auto  h = _mm_mul_pd( _mm_mul_pd( _mm_set1_pd( 0.5 ), f ), f );
+
+    return _mm_sub_pd( _mm_mul_pd( k, _mm_set1_pd( ln2_hi ) ),
+      _mm_sub_pd( _mm_sub_pd( h, _mm_add_pd( _mm_mul_pd( s, _mm_add_pd( h, r ) ), _mm_mul_pd( k, _mm_set1_pd( ln2_lo ) ) ) ), f ) );
+  }
+
+  static  auto  ScoreSSE2( const double* matrix, unsigned nterms, const double* nwords, double floor, double* weight ) -> uint32_t
+  {
+    uint32_t  output = 0;
+
+    for ( unsigned i = 0; i != BM25Block::block_size; i += 2 )
+    {
+      auto  product = _mm_set1_pd( 1.0 );
+
+      for ( unsigned t = 0; t != nterms; ++t )
+        product = _mm_mul_pd( product, _mm_loadu_pd( matrix + t * BM25Block::block_size + i ) );
+
+      auto  words = _mm_loadu_pd( nwords + i );
+      auto  haswd = _mm_cmpgt_pd( words, _mm_setzero_pd() );
+      auto  scale = Log( _mm_add_pd( _mm_set1_pd( 2.0 ), words ) );
+      auto  value = _mm_div_pd( _mm_sub_pd( _mm_set1_pd( 1.0 ), product ),
+        _mm_or_pd( _mm_and_pd( haswd, scale ), _mm_andnot_pd( haswd, _mm_set1_pd( 1.0 ) ) ) );
+
+      _mm_storeu_pd( weight + i, value );
+
+      output |= uint32_t(_mm_movemask_pd( _mm_cmpge_pd( value, _mm_set1_pd( floor ) ) )) << i;
+    }
+    return output;
+  }
+
+  __attribute__((target("avx2")))
+  static  auto  Log( __m256d x ) -> __m256d
+  {
+    auto  bits = _mm256_castpd_si256( x );
+    auto  k = _mm256_castsi256_pd( _mm256_or_si256( _mm256_srli_epi64( bits, 52 ), _mm256_set1_epi64x( big_exponent ) ) );
+    auto  m = _mm256_castsi256_pd( _mm256_or_si256( _mm256_and_si256( bits, _mm256_set1_epi64x( mantissa_bits ) ), _mm256_set1_epi64x( one_exponent ) ) );
+    auto  c = _mm256_cmp_pd( m, _mm256_set1_pd( sqrt_2 ), _CMP_GE_OQ );
+
+    k = _mm256_sub_pd( k, _mm256_set1_pd( e_bias ) );
+    m = _mm256_blendv_pd( m, _mm256_mul_pd( m, _mm256_set1_pd( 0.5 ) ), c );
+    k = _mm256_blendv_pd( k, _mm256_add_pd( k, _mm256_set1_pd( 1.0 ) ), c );
+
+    auto  f = _mm256_sub_pd( m, _mm256_set1_pd( 1.0 ) );
+    auto  s = _mm256_div_pd( f, _mm256_add_pd( _mm256_set1_pd( 2.0 ), f ) );
+    auto  z = _mm256_mul_pd( s, s );
+    auto  w = _mm256_mul_pd( z, z );
+    auto  r = _mm256_add_pd(
+      _mm256_mul_pd( z, _mm256_add_pd( _mm256_set1_pd( Lg1 ), _mm256_mul_pd( w, _mm256_add_pd( _mm256_set1_pd( Lg3 ), _mm256_mul_pd( w,
+        _mm256_add_pd( _mm256_set1_pd( Lg5 ), _mm256_mul_pd( w, _mm256_set1_pd( Lg7 ) ) ) ) ) ) ) ),
+      _mm256_mul_pd( w, _mm256_add_pd( _mm256_set1_pd( Lg2 ), _mm256_mul_pd( w,
+        _mm256_add_pd( _mm256_set1_pd( Lg4 ), _mm256_mul_pd( w, _mm256_set1_pd( Lg6 ) ) ) ) ) ) );
+    auto  h = _mm256_mul_pd( _mm256_mul_pd( _mm256_set1_pd( 0.5 ), f ), f );
+
+    return _mm256_sub_pd( _mm256_mul_pd( k, _mm256_set1_pd( ln2_hi ) ),
+      _mm256_sub_pd( _mm256_sub_pd( h, _mm256_add_pd( _mm256_mul_pd( s, _mm256_add_pd( h, r ) ), _mm256_mul_pd( k, _mm256_set1_pd( ln2_lo ) ) ) ), f ) );
+  }
+
+  __attribute__((target("avx2")))
+  static  auto  ScoreAVX2( const double* matrix, unsigned nterms, const double* nwords, double floor, double* weight ) -> uint32_t
+  {
+    uint32_t  output = 0;
+
+    for ( unsigned i = 0; i != BM25Block::block_size; i += 4 )
+    {
+      auto  product = _mm256_set1_pd( 1.0 );
+
+      for ( unsigned t = 0; t != nterms; ++t )
+        product = _mm256_mul_pd( product, _mm256_loadu_pd( matrix + t * BM25Block::block_size + i ) );
+
+      auto  words = _mm256_loadu_pd( nwords + i );
+      auto  haswd = _mm256_cmp_pd( words, _mm256_setzero_pd(), _CMP_GT_OQ );
+      auto  scale = Log( _mm256_add_pd( _mm256_set1_pd( 2.0 ), words ) );
+      auto  value = _mm256_div_pd( _mm256_sub_pd( _mm256_set1_pd( 1.0 ), product ),
+        _mm256_blendv_pd( _mm256_set1_pd( 1.0 ), scale, haswd ) );
+
+      _mm256_storeu_pd( weight + i, value );
+
+      output |= uint32_t(_mm256_movemask_pd( _mm256_cmp_pd( value, _mm256_set1_pd( floor ), _CMP_GE_OQ ) )) << i;
+    }
+    return output;
+  }
+
+# endif   // BM25_X86_KERNELS
+
+  // BM25Block implementation
+
+  auto  BM25Block::Score( double floor, Kernel kernel ) -> uint32_t
+  {
+    uint32_t  output;
+
+    switch ( kernel )
+    {
+  # if defined( BM25_X86_KERNELS )
+      case Kernel::AVX2:
+        output = ScoreAVX2( fmatrix.data(), nterms, nwords, floor, weight );
+        break;
+      case Kernel::SSE2:
+        output = ScoreSSE2( fmatrix.data(), nterms, nwords, floor, weight );
+        break;
+  # endif
+      default:
+        output = ScoreScalar( fmatrix.data(), nterms, nwords, floor, weight );
+        break;
+    }
+    return output & ((1U << ncount) - 1);
+  }
+
+ /*
+  * Select()
+  *
+  * Selects the best kernel supported by the CPU once
+  */
+  auto  BM25Block::Select() -> Kernel
+  {
+    static const auto kernel = Supported( Kernel::AVX2 ) ? Kernel::AVX2 :
+      Supported( Kernel::SSE2 ) ? Kernel::SSE2 : Kernel::Scalar;
+
+    return kernel;
+  }
+
+  bool  BM25Block::Supported( Kernel kernel )
+  {
+    switch ( kernel )
+    {
+      case Kernel::Scalar:
+        return true;
+  # if defined( BM25_X86_KERNELS )
+      case Kernel::SSE2:
+        return true;
+      case Kernel::AVX2:
+        return __builtin_cpu_init(), __builtin_cpu_supports( "avx2" ) != 0;
+  # endif
+      default:
+        return false;
+    }
+  }
+
+ /*
+  * Weight( product, words )
+  *
+  * The scalar weight of the document by the product of ( 1 - idf ) of it's factors
+  */
+  auto  BM25Block::Weight( double product, double words ) -> double
+  {
+    return words > 0.0 ? (1.0 - product) / Log( 2.0 + words ) : 1.0 - product;
+  }
+
+}}
@@ -0,0 +1,93 @@
+# if !defined( __palmira_src_service_collect_bm25_hpp__ )
+# define __palmira_src_service_collect_bm25_hpp__
+# include <cstdint>
+# include <vector>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * BM25Block
+  *
+  * Block of the BM25 abstracts buffered by the collector to be scored at once:
+  *
+  *   weight = (1 - prod( 1 - idf )) / log( 2 + nWords )
+  *
+  * The factors are transposed to the matrix of ( 1 - idf ) by the term and the
+  * document, padded by 1.0 for the documents having less factors, so the products,
+  * the logarithms and the check against the worst weight kept are computed by the
+  * vector kernel selected for the CPU at runtime.
+  *
+  * All the kernels and Weight() compute the logarithm by the same polynomial in
+  * the same order, so the weights are bit-identical whatever path computed them.
+  */
+  class BM25Block final
+  {
+  public:
+    enum: unsigned {  block_size = 16  };
+
+    enum class Kernel
+    {
+      Scalar,
+      SSE2,
+      AVX2
+    };
+
+  public:
+    auto  size() const -> unsigned  {  return ncount;  }
+    bool  full() const  {  return ncount == block_size;  }
+    void  clear() {  ncount = 0;  }
+
+    auto  GetId( unsigned i ) const -> uint32_t {  return docids[i];  }
+    auto  GetWeight( unsigned i ) const -> double {  return weight[i];  }
+
+   /*
+    * Add( id, words, factors )
+    *
+    * Buffers the document; the factors are the structures with dblIDF member
+    */
+    template <class Factor>
+    void  Add( uint32_t id, double words, const Factor* pbeg, const Factor* pend )
+    {
+      auto  nfacts = unsigned(pend - pbeg);
+      auto  column = (double*)nullptr;
+
+      if ( nfacts > nterms )
+        fmatrix.resize( (nterms = nfacts) * block_size, 1.0 );
+
+      column = fmatrix.data() + ncount;
+
+      for ( unsigned i = 0; i != nterms; ++i, column += block_size )
+        *column = i < nfacts ? 1.0 - pbeg[i].dblIDF : 1.0;
+
+      docids[ncount] = id;
+      nwords[ncount++] = words;
+    }
+
+   /*
+    * Score( floor )
+    *
+    * Computes the weights of the documents buffered; returns the bit mask of the
+    * documents weighted not less than the floor passed
+    */
+    auto  Score( double floor ) -> uint32_t {  return Score( floor, Select() );  }
+    auto  Score( double floor, Kernel ) -> uint32_t;
+
+  public:
+    static  auto  Select() -> Kernel;
+    static  bool  Supported( Kernel );
+    static  auto  Weight( double product, double words ) -> double;
+
+  protected:
+    uint32_t            docids[block_size];
+    double              nwords[block_size] = {};
+    double              weight[block_size];
+    std::vector<double> fmatrix;    // ( 1 - idf ) by [term][document]
+    unsigned            nterms = 0;
+    unsigned            ncount = 0;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_collect_bm25_hpp__
@@ -1,19 +1,48 @@
 # include "collect.hpp"
 # include "collect-quotes.hpp"
+# include "collect-filter.hpp"
+# include "collect-order.hpp"
+# include "collect-facets.hpp"
+# include "collect-groups.hpp"
+# include "collect-bm25.hpp"
+# include "top-docs.hpp"
 # include "structo/compat.hpp"
 # include <stdexcept>
+# include <algorithm>
+# include <cstring>
+# include <chrono>
+# include <vector>
+# include <atomic>
 # include <cmath>
-#include <condition_variable>
-#include <mtc/json.h>
-#include <mtc/recursive_shared_mutex.hpp>
+# include <mtc/recursive_shared_mutex.hpp>
 
 namespace palmira {
 namespace collect {
 
  /*
-  * size limit for one section in parallel processing
+  * size limits for one section in parallel processing
   */
-  constexpr uint32_t  max_thread_section = 0x4000;
+  constexpr uint32_t  min_thread_section = 0x400;
+  constexpr uint32_t  max_thread_section = 0x10000;
+
+ /*
+  * the second phase ranking limits: the count of the documents reranked and the
+  * minimal count of the documents reranked by one task
+  */
+  constexpr uint32_t  max_rerank_window = 10000;
+  constexpr uint32_t  min_rerank_section = 0x40;
+
+ /*
+  * the count of the documents passed to the ranker plugin at once
+  */
+  constexpr unsigned  plugin_block_size = 0x40;
+
+ /*
+  * sampling parameters for the estimated count: the docid range is split to
+  * estimate_sections slices, and each n-th slice is counted up to estimate_samples
+  */
+  constexpr uint32_t  estimate_sections = 0x400;
+  constexpr uint32_t  estimate_samples = 0x40;
 
  /*
   * Коллекция настроек коллектора
@@ -21,6 +50,9 @@ namespace collect {
   class Documents::data
   {
   public:
+    using clock_type = std::chrono::steady_clock;
+    using time_point = clock_type::time_point;
+
     struct WrapDifferFn
     {
       DifferFn  differ;
@@ -37,18 +69,89 @@ namespace collect {
       return res != 0 ? res : d1 - d2;
     }
 
-    using Threads = mtc::ThreadPool;
-
     static
     auto  GetRange( uint32_t, const Abstract& ) -> double;
 
+   /*
+    * The built-in weights of the Rich and BM25 abstracts, inlined into the loop
+    */
+    static
+    auto  GetRich( const Abstract& tuples ) -> double
+    {
+      const Abstract::EntrySet* best = nullptr;
+      double                    weight = 0.0;
+
+      for ( auto p = tuples.entries.pbeg; p < tuples.entries.pend; ++p )
+        if ( best == nullptr || best->weight < p->weight )
+          weight = (best = p)->weight;
+
+      return weight/* / log10( 2 + tuples.nWords )*/;
+    }
+    static
+    auto  GetBM25( const Abstract& tuples ) -> double
+    {
+      double  weight = 1.0;
+
+      for ( auto p = tuples.factors.pbeg; p < tuples.factors.pend; ++p )
+        weight *= (1.0 - p->dblIDF);
+      return BM25Block::Weight( weight, tuples.nWords );
+    }
+
+   /*
+    * Checks if the default ranking and order functions are used
+    */
+    static
+    bool  IsDefault( const RankerFn& fn )
+    {
+      auto  target = fn.target<double(*)( uint32_t, const Abstract& )>();
+      return target != nullptr && *target == &GetRange;
+    }
+    static
+    bool  IsDefault( const DifferFn& fn )
+    {
+      auto  target = fn.target<int(*)( uint32_t, double, uint32_t, double )>();
+      return target != nullptr && *target == &compareByRange;
+    }
+
+   /*
+    * The count of the best documents kept: the page or the second phase window
+    */
+    static
+    auto  GetLimit( const data& params ) -> unsigned
+    {
+      return std::max( params.nfirst + params.ncount - 1, params.rerank != nullptr ? params.ntop : 0 );
+    }
+
+    static
+    auto  Elapsed( time_point since ) -> uint64_t
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - since ).count();
+    }
+
   public:
-    uint32_t  nfirst = 1;
-    uint32_t  ncount = 10;
-    DifferFn  differ = compareByRange;
-    RankerFn  ranker = &GetRange;
-    QuotesFn  quoter;
-    Threads*  async = nullptr;
+    uint32_t    nfirst = 1;
+    uint32_t    ncount = 10;
+    DifferFn    differ = compareByRange;
+    RankerFn    ranker = &GetRange;
+    mtc::api<IRanker> plugin;     // the blocks ranker, ranker calls it for one document
+    RerankFn    rerank;
+    uint32_t    ntop = 0;         // the count of the documents reranked
+    QuotesFn    quoter;
+    double      qtime = -1.0;
+    Executor*   async = nullptr;
+    unsigned    nlimit = 0;
+    time_point  expiry = time_point::max();
+    Mode        dwmode = Mode::Ranked;
+    std::shared_ptr<const Filter> filter;
+    std::shared_ptr<const SortKeys> sorter;
+    std::shared_ptr<const FacetSpec> facets;
+    std::shared_ptr<const GroupSpec> groups;
+    bool        hafter = false;   // documents after the cursor only
+    uint32_t    idlast = 0;
+    double      wtlast = 0.0;
+    std::vector<uint64_t> kylast;   // sort keys of the cursor
+    bool        profile = false;  // report the phases timings and the counters
+    unsigned    rankas = Abstract::None;  // the built-in ranking selected for the query
 
   };
 
@@ -60,10 +163,86 @@ namespace collect {
     struct linear_t  {};
     constexpr static linear_t linear = {};
 
-    struct Entity
+    class Sections;
+
+   /*
+    * Counters
+    *
+    * The phases timings, microseconds, and the work counters of the collector; the
+    * timings are cheap at the phase granularity, so they are always measured
+    */
+    struct Counters
     {
-      uint32_t  id;
-      double    weight;
+      uint64_t  search = 0;
+      uint64_t  merge = 0;
+      uint64_t  rerank = 0;
+      uint64_t  quotes = 0;
+      uint64_t  fetch = 0;
+      uint64_t  tuples = 0;     // tuples evaluated
+      uint64_t  quoted = 0;     // abstracts copied
+      uint64_t  slices = 0;     // index sections processed
+    };
+
+   /*
+    * Compare
+    *
+    * The documents order: the default order by range and the metadata keys are
+    * compared inline, else the order function is called.  The top documents keep
+    * the keys packed and compare them before, so the documents having equal keys
+    * only are compared by relevance; the groups read the keys from the columns.
+    */
+    struct Compare
+    {
+      const DifferFn& differ;
+      const SortKeys* sorter;
+      const bool      ranged;
+      const bool      packed;
+
+      Compare( const DifferFn& fn, const SortKeys* sk, bool pk = false ):
+        differ( fn ), sorter( sk ), ranged( sk == nullptr && IsDefault( fn ) ), packed( pk ) {}
+
+      int   operator()( uint32_t d1, double f1, uint32_t d2, double f2 ) const
+      {
+        return ranged ? compareByRange( d1, f1, d2, f2 ) :
+          sorter == nullptr ? differ( d1, f1, d2, f2 ) :
+          packed ? SortKeys::Relevance( d1, f1, d2, f2 ) : sorter->Compare( d1, f1, d2, f2 );
+      }
+    };
+
+   /*
+    * The rankers of the traversal loop: the built-in weights of the abstract mode
+    * selected for the query, falling back to GetRange() for the other modes, and
+    * the generic ranking function; the BM25 abstracts are buffered to the blocks
+    * scored by the vector kernel
+    */
+    struct RankRich
+    {
+      double  operator()( uint32_t id, const Abstract& tuples ) const
+        {  return tuples.dwMode == Abstract::Rich ? GetRich( tuples ) : GetRange( id, tuples );  }
+    };
+
+    struct RankBM25
+    {
+      BM25Block block;
+    };
+
+    struct RankPlug
+    {
+      IRanker*  plugin;
+      Abstracts copies;
+      std::vector<IRanker::Document> blocks;
+      double    values[plugin_block_size];
+
+      RankPlug( IRanker* pr ): plugin( pr ), copies( plugin_block_size )
+        {  blocks.reserve( plugin_block_size );  }
+    };
+
+    struct RankFunc
+    {
+      const RankerFn& ranker;
+
+      double  operator()( uint32_t id, const Abstract& tuples ) const
+        {  return ranker( id, tuples );  }
     };
 
     void  operator delete( void* p )
@@ -76,8 +255,14 @@ namespace collect {
   protected:  // construction
     impl( const data& params ): data( params ),
       nFirst( params.nfirst ),
-      nLimit( params.nfirst + params.ncount - 1 ),
-      quoBox( nLimit ) {}
+      nLimit( GetLimit( params ) ),
+      nPaged( params.nfirst + params.ncount - 1 ),
+      nWidth( GetWidth( params ) ),
+      quoBox( params.quoter != nullptr ? GetQuotes( params ) : 0 ),
+      fCount( params.facets != nullptr ? new Facets( *params.facets ) : nullptr ),
+      topGrp( params.groups != nullptr ? new TopGroups<Compare>( *params.groups, nLimit, Compare{ differ, sorter.get() } ) : nullptr ),
+      topDoc( DocIds(), Weight(), nLimit, Compare{ differ, sorter.get(), true }, SortKey(), nWidth ),
+      kyNext( nWidth ) {}
 
   public:     // creation
     static
@@ -91,25 +276,117 @@ namespace collect {
     auto  Finish( mtc::api<IContentsIndex> ) -> mtc::zmap override;
 
   protected:  // using partial queries
-    void  Insert( const impl& );
+    bool  Sample( mtc::api<IQuery> );
+    void  Merge( const std::vector<mtc::api<impl>>& );
+    void  Regroup( mtc::api<IQuery> );
+    void  Rerank();
+    void  Order();
+    void  Quotes( std::vector<uint32_t> );
+    auto  Fetch( mtc::api<IContentsIndex>, const std::vector<std::pair<uint32_t, double>>&, mtc::zmap& ) -> std::vector<mtc::zmap>;
     bool  Search( linear_t, mtc::api<IQuery> );
-    auto  Buffer() const -> Entity* {  return (Entity*)(this + 1);  }
+    template <class Ranker>
+    bool  Search( linear_t, mtc::api<IQuery>, Ranker );
+    template <class Ranker>
+    void  Rank( uint32_t id, const Abstract& tuples, Ranker& rankfn ) {  Place( id, rankfn( id, tuples ) );  }
+    void  Rank( uint32_t, const Abstract&, RankBM25& );
+    void  Rank( uint32_t, const Abstract&, RankPlug& );
+    template <class Ranker>
+    void  Flush( Ranker& ) {}
+    void  Flush( RankBM25& );
+    void  Flush( RankPlug& );
+    void  Place( uint32_t, double );
+    auto  Probe( mtc::api<IQuery> ) -> unsigned;
+    int   Follows( uint32_t, double, const uint64_t* ) const;
+    auto  SortKey() -> uint64_t* {  return (uint64_t*)(this + 1);  }
+    auto  Weight() -> double*   {  return (double*)(SortKey() + (nLimit + 1) * nWidth);  }
+    auto  DocIds() -> uint32_t* {  return (uint32_t*)(Weight() + nLimit);  }
+
+   /*
+    * The count of the sort key words kept for a document, the keys are packed once
+    */
+    static
+    auto  GetWidth( const data& params ) -> unsigned
+    {
+      return params.sorter != nullptr && params.groups == nullptr ? unsigned(params.sorter->Width()) : 0;
+    }
+
+   /*
+    * The count of the abstracts kept: each group on the page shows up to the group
+    * size documents
+    */
+    static
+    auto  GetQuotes( const data& params ) -> unsigned
+    {
+      return params.groups != nullptr ? params.ncount * params.groups->GetSize() : params.ncount;
+    }
 
   private:
     const unsigned    nFirst;
     const unsigned    nLimit;
+    const unsigned    nPaged;
+    const unsigned    nWidth;
 
-    std::mutex        mxLock;
     mtc::api<IQuery>  pQuery;
     Abstracts         quoBox;
-    unsigned          nCount = 0;
+    std::unique_ptr<Facets> fCount;
+    std::unique_ptr<TopGroups<Compare>> topGrp;
+    TopDocs<Compare>  topDoc;
+    std::vector<uint64_t> kyNext;   // the sort keys of the document placed
     unsigned          nFound = 0;
-    Entity*           pWorst = nullptr;
+    bool              sorted = false;
+    bool              expired = false;
+    mtc::zmap         zRange;     // the confidence interval of the estimated count
+    Counters          pStats;
+    mtc::array_zmap   aParts;     // the profiles of the partial collectors
+  };
+
+ /*
+  * Documents::impl::Sections
+  *
+  * Guided self-scheduling of the docid range: each sub-collector takes the next
+  * section of the query from the shared cursor until the range is exhausted.
+  * Section length decreases with the rest of the range, so the dense parts of
+  * the index do not stick to one thread while the others stay idle.
+  */
+  class Documents::impl::Sections
+  {
+    std::mutex        mxLock;
+    mtc::api<IQuery>  pQuery;
+    uint32_t          cursor = 0;
+    bool              passed = false;   // the sections left were skipped by the deadline
+    const uint32_t    uLimit;
+    const uint32_t    nSlice;
+    const time_point  expiry;
+
+  public:
+    Sections( mtc::api<IQuery> query, uint32_t limit, unsigned nparts, time_point tlimit ):
+      pQuery( query ), uLimit( limit ), nSlice( nparts * 4 ), expiry( tlimit ) {}
+
+    auto  Get() -> mtc::api<IQuery>
+    {
+      auto  exLock = mtc::make_unique_lock( mxLock );
+
+      if ( expiry != time_point::max() && clock_type::now() >= expiry )
+        return passed = cursor < uLimit, nullptr;
+
+      while ( cursor < uLimit )
+      {
+        auto  uLower = cursor;
+        auto  uUpper = uLower + std::min( std::max( (uLimit - uLower) / nSlice, min_thread_section ), max_thread_section );
+        auto  sQuery = pQuery->Duplicate( { uLower, cursor = std::min( uUpper, uLimit ) } );
+
+        if ( sQuery != nullptr )
+          return sQuery;
+      }
+      return nullptr;
+    }
+    bool  Expired() const {  return passed;  }
   };
 
   auto  Documents::impl::Create( const data& params ) -> impl*
   {
-    auto  nalloc = sizeof(impl) + (params.nfirst + params.ncount - 1) * sizeof(Entity);
+    auto  nalloc = sizeof(impl) + GetLimit( params ) * (sizeof(double) + sizeof(uint32_t))
+      + (GetLimit( params ) + 1) * GetWidth( params ) * sizeof(uint64_t);
     auto  nitems = (sizeof(impl) + nalloc - 1) / sizeof(impl);
     auto  palloc = std::allocator<impl>().allocate( nitems );
 
@@ -119,50 +396,70 @@ namespace collect {
   void  Documents::impl::Search( mtc::api<IQuery> query )
   {
     uint32_t  rBound;
+    unsigned  nParts;
+    auto      tstart = clock_type::now();
+
+    pQuery = query;
+
+  // estimate the count by the sample of the index sections
+    if ( dwmode == Mode::Estimate && Sample( query ) )
+      return (void)(pStats.search = Elapsed( tstart ));
+
+  // select the built-in ranking inlined into the loop once per query
+    if ( dwmode == Mode::Ranked && IsDefault( ranker ) )
+      rankas = Probe( query );
 
   // check if multikernel processing enabled and needed
-    if ( async != nullptr && (rBound = query->LastIndex()) > max_thread_section * 4 )
+    if ( async != nullptr && (rBound = query->LastIndex()) > min_thread_section * 4 )
     {
-      std::mutex              mxWait;
-      auto                    mxLock = mtc::make_unique_lock( mxWait );
-      std::condition_variable cvWait;
-      std::atomic_long        nParts = 0;   // executor threads
-      int  nloops = 0;
-      int  nquery = 0;
-      std::atomic_int  nmerge = 0;
-      std::atomic nfound = 0;
+      auto  actors = Executor::Tasks( async, nlimit );
 
-      //
-      // share query execution to parts
-      //
-      for ( uint32_t uLower = 0; uLower < rBound; uLower += max_thread_section )
+      if ( (nParts = std::min( actors.GetLimit(), rBound / min_thread_section )) > 1 )
       {
-        ++nloops;
-        auto  subQuery = query->Duplicate( { uLower, uLower + max_thread_section } );
+        auto  ranges = Sections( query, rBound + 1, nParts, expiry );
+        auto  stores = std::vector<mtc::api<impl>>();
+        auto  params = data( *this );
 
-        if ( subQuery != nullptr )
-        {
-          ++nquery;
-          ++nParts;
+        params.quoter = nullptr;    // partial collectors never quote
 
-          async->Insert( [&, this, subQuery, subStore = mtc::api( Create( *this ) )]()
+      //
+      // start sub-collectors picking the index sections until the whole range is processed;
+      // each sub-collector keeps it's own top documents and orders them when finished
+      //
+        for ( stores.reserve( nParts ); stores.size() != nParts; )
+        {
+          actors.Insert( [&ranges, subStore = stores.emplace_back( Create( params ) )]()
           {
-            if ( subStore->Search( linear, subQuery ) )
-              this->Insert( *subStore.ptr() );
+            auto  tstart = clock_type::now();
+
+            for ( auto subQuery = ranges.Get(); subQuery != nullptr; subQuery = ranges.Get() )
+              subStore->Search( linear, subQuery ), ++subStore->pStats.slices;
 
-            ++nmerge;
-            nfound += subStore->nFound;
-            if ( --nParts == 0 )
-              cvWait.notify_all();
+            subStore->Order();
+            subStore->pStats.search = Elapsed( tstart );
           } );
         }
-      }
 
-      // wait until the execution finished
-      cvWait.wait( mxLock );
+      // wait until the execution finished and merge the partial results
+        actors.Wait();
+
+        auto  tmerge = clock_type::now();
+          Merge( stores );
+        pStats.merge = Elapsed( tmerge );
+
+        expired |= ranges.Expired();
+
+        Regroup( query );
+
+        pStats.search = Elapsed( tstart ) - pStats.merge;
+        return Rerank();
+      }
     }
-      else
-    Search( linear, query );
+    Search( linear, query ), ++pStats.slices;
+    Regroup( query );
+
+    pStats.search = Elapsed( tstart );
+    Rerank();
   }
 
   auto  Documents::impl::Finish( mtc::api<IContentsIndex> pIndex ) -> mtc::zmap
@@ -171,20 +468,140 @@ namespace collect {
       { "first", uint32_t(nFirst) },
       { "found", uint32_t(nFound) } };
 
-    if ( nCount >= nFirst )
+  // search was interrupted by timeout, so 'found' is the lower bound
+    if ( expired )
+      report["partial"] = true;
+
+    if ( !zRange.empty() )
+      report["estimate"] = zRange;
+
+  // the facets are counted for the exact search only
+    if ( fCount != nullptr && zRange.empty() )
+      report["facets"] = fCount->Report();
+
+  // the groups are paged as the documents are, each listing it's best documents
+    if ( topGrp != nullptr )
+    {
+      topGrp->Sort();
+
+      if ( topGrp->size() >= nFirst )
+      {
+        auto  pgroup = report.set_array_zmap( "groups" );
+        auto  inpage = std::vector<std::pair<uint32_t, double>>();
+
+        report["count"] = uint32_t(topGrp->size() + 1 - nFirst);
+
+        for ( auto npos = nFirst - 1; npos != topGrp->size(); ++npos )
+          inpage.insert( inpage.end(), (*topGrp)[npos].items.begin(), (*topGrp)[npos].items.end() );
+
+        auto  aitems = Fetch( pIndex, inpage, report );
+        auto  pitems = aitems.begin();
+
+        for ( auto npos = nFirst - 1; npos != topGrp->size(); ++npos )
+        {
+          auto& agroup = (*topGrp)[npos];
+          auto  zgroup = mtc::zmap{ { "found", uint32_t(agroup.found) } };
+          auto  zvalue = groups->GetValue( agroup.first.first );
+          auto  zitems = zgroup.set_array_zmap( "items" );
+
+          if ( zvalue.get_type() != mtc::zval::z_untyped )
+            zgroup["value"] = std::move( zvalue );
+
+          for ( size_t i = 0; i != agroup.items.size(); ++i )
+            zitems->push_back( std::move( *pitems++ ) );
+
+          pgroup->push_back( std::move( zgroup ) );
+        }
+      }
+    }
+      else
+    if ( topDoc.size() >= nFirst )
     {
       auto  pitems = report.set_array_zmap( "items" );
+      auto  inpage = std::vector<std::pair<uint32_t, double>>();
 
-      report["count"] = uint32_t(nCount + 1 - nFirst);
+      report["count"] = uint32_t(topDoc.size() + 1 - nFirst);
 
-      std::sort( Buffer(), Buffer() + nCount, [this]( const Entity& l, const Entity& r )
-        {  return differ( l.id, l.weight, r.id, r.weight ) < 0;  } );
+      Order();
 
-      for ( auto beg = Buffer() + nFirst - 1, end = Buffer() + nCount; beg != end; ++beg )
+    // the cursor to continue from the last document on the page; the reranked pages
+    // are not continued, as the second phase window is cut
+      if ( rerank == nullptr )
       {
-        auto  entity = pIndex->GetEntity( beg->id );
+        report["cursor"] = MakeCursor( topDoc.GetIds()[topDoc.size() - 1], topDoc.GetWts()[topDoc.size() - 1],
+          std::vector<uint64_t>( topDoc.GetKeys( topDoc.size() - 1 ), topDoc.GetKeys( topDoc.size() ) ) );
+      }
+
+      for ( auto npos = nFirst - 1; npos != topDoc.size(); ++npos )
+        inpage.push_back( { topDoc.GetIds()[npos], topDoc.GetWts()[npos] } );
+
+      for ( auto& next: Fetch( pIndex, inpage, report ) )
+        pitems->push_back( std::move( next ) );
+    }
+
+    if ( profile )
+    {
+      auto  zstats = mtc::zmap{
+        { "search_us",  pStats.search },
+        { "merge_us",   pStats.merge },
+        { "rerank_us",  pStats.rerank },
+        { "quotes_us",  pStats.quotes },
+        { "fetch_us",   pStats.fetch },
+        { "matched",    uint64_t(nFound) },
+        { "tuples",     pStats.tuples },
+        { "abstracts",  pStats.quoted },
+        { "sections",   pStats.slices } };
+
+      if ( !aParts.empty() )
+        zstats["partitions"] = aParts;
+
+      report["profile"] = std::move( zstats );
+    }
+    return report;
+  }
+
+ /*
+  * Fetch( index, documents, report )
+  *
+  * Fetches the entities of the documents on the page and builds the quotations
+  * in parallel; reports 'quotes_partial' if the quotation time budget is over
+  */
+  auto  Documents::impl::Fetch(
+    mtc::api<IContentsIndex>                      pIndex,
+    const std::vector<std::pair<uint32_t, double>>& inpage, mtc::zmap& report ) -> std::vector<mtc::zmap>
+  {
+    auto  actors = Executor::Tasks( async, nlimit );
+    auto  aitems = std::vector<mtc::zmap>( inpage.size() );
+    auto  tlimit = time_point();
+    auto  noquot = std::atomic_bool( false );
+    auto  tstart = clock_type::now();
+
+  // get the abstracts of the documents on the page only
+    if ( quoter != nullptr )
+    {
+      auto  docids = std::vector<uint32_t>();
+
+      for ( auto& next: inpage )
+        docids.push_back( next.first );
+
+      Quotes( std::move( docids ) );
+
+      pStats.quotes = Elapsed( tstart );
+      tstart = clock_type::now();
+    }
+
+    tlimit = qtime < 0.0 ? expiry :
+      std::min( expiry, clock_type::now() + std::chrono::microseconds( int64_t(qtime * 1000000) ) );
+
+    for ( size_t npos = 0; npos != inpage.size(); ++npos )
+    {
+      actors.Insert( [&, npos]()
+      {
+        auto  doc_id = inpage[npos].first;
+        auto  entity = pIndex->GetEntity( doc_id );
         auto  pExtra = entity != nullptr ? entity->GetExtra() : nullptr;
         auto  zExtra = mtc::zmap();
+        auto& zpitem = aitems[npos];
 
         if ( entity == nullptr )
           throw std::logic_error( "index has no entity found by index @" __FILE__ ":" LINE_STRING );
@@ -192,133 +609,519 @@ namespace collect {
         if ( pExtra != nullptr && pExtra->GetLen() != 0 )
           (void)::FetchFrom( mtc::sourcebuf( pExtra->GetPtr(), pExtra->GetLen() ).ptr(), zExtra );
 
-        pitems->push_back( {
+        zpitem = {
           { "id",     std::string( entity->GetId() ) },
-          { "index",  beg->id },
+          { "index",  doc_id },
           { "extra",  zExtra },
-          { "range",  beg->weight } } );
+          { "range",  inpage[npos].second } };
+
+      // if quotation enabled, set the found element quote within the time budget
+        if ( quoter != nullptr && quoBox.Get( doc_id ) != nullptr )
+        {
+          if ( tlimit == time_point::max() || clock_type::now() < tlimit )
+            zpitem.set_array_zval( "quote", std::move( quoter( doc_id, *quoBox.Get( doc_id ) ) ) );
+          else noquot = true;
+        }
+      } );
+    }
+
+    actors.Wait();
+
+    pStats.fetch = Elapsed( tstart );
+
+    if ( noquot )
+      report["quotes_partial"] = true;
+
+    return aitems;
+  }
 
-      // if quotation enabled, set the found element quote
-        if ( quoter != nullptr && quoBox.Get( beg->id ) != nullptr )
-          pitems->back().set_array_zval( "quote", std::move( quoter( beg->id, *quoBox.Get( beg->id ) ) ) );
+ /*
+  * Merge()
+  *
+  * Слияние упорядоченных результатов частичных коллекторов после завершения
+  * параллельного поиска: k-way merge через кучу курсоров, без блокировок
+  */
+  void  Documents::impl::Merge( const std::vector<mtc::api<impl>>& parts )
+  {
+    struct Source
+    {
+      const uint32_t* ids;
+      const double*   wts;
+      unsigned        pos;
+      unsigned        end;
+      const impl*     src;
+
+      auto  keys() const -> const uint64_t*  {  return src->topDoc.GetKeys( pos );  }
+    };
+
+    auto  fcmp = Compare{ differ, sorter.get() };
+    auto  worse = [this, &fcmp]( const Source& l, const Source& r )
+      {
+        return (nWidth != 0 ?
+          sorter->Compare( l.keys(), l.ids[l.pos], l.wts[l.pos], r.keys(), r.ids[r.pos], r.wts[r.pos] ) :
+          fcmp( l.ids[l.pos], l.wts[l.pos], r.ids[r.pos], r.wts[r.pos] )) > 0;
+      };
+    auto  heap = std::vector<Source>();
+    auto  ncount = 0U;
+
+    for ( auto& next: parts )
+    {
+      if ( next->topDoc.size() != 0 )
+        heap.push_back( { next->topDoc.GetIds(), next->topDoc.GetWts(), 0, next->topDoc.size(), next.ptr() } );
+      nFound += next->nFound;
+      expired |= next->expired;
+      pStats.tuples += next->pStats.tuples;
+      pStats.slices += next->pStats.slices;
+
+      if ( profile )
+      {
+        aParts.push_back( {
+          { "elapsed_us", next->pStats.search },
+          { "sections",   next->pStats.slices },
+          { "matched",    uint64_t(next->nFound) },
+          { "tuples",     next->pStats.tuples } } );
       }
+
+      if ( fCount != nullptr )
+        fCount->Merge( *next->fCount );
+      if ( topGrp != nullptr )
+        topGrp->Merge( *next->topGrp );
     }
-    return report;
+
+    std::make_heap( heap.begin(), heap.end(), worse );
+
+    for ( auto pids = DocIds(), pwts = Weight(); !heap.empty() && ncount < nLimit; ++ncount )
+    {
+      auto& best = (std::pop_heap( heap.begin(), heap.end(), worse ), heap.back());
+
+      pids[ncount] = best.ids[best.pos];
+      pwts[ncount] = best.wts[best.pos];
+
+      std::copy_n( best.keys(), nWidth, SortKey() + size_t(ncount) * nWidth );
+
+      if ( ++best.pos != best.end )  std::push_heap( heap.begin(), heap.end(), worse );
+        else heap.pop_back();
+    }
+    topDoc.SetSize( ncount );
+    sorted = true;
   }
 
  /*
-  * Вливание порции найденных документов в результирующий контейнер. Выполняется
-  * через пересортировки, чтобы не искать каждый раз "худший", а замещать лучшими
-  * из списка найденных
+  * Sample( query )
+  *
+  * Counts the matches in each n-th slice of the docid range and extrapolates
+  * the count to the whole range.  The interval reported is the normal 95%
+  * confidence interval of the systematic sample of the slice densities.
+  * Returns false if the range is too short to be sampled, so the exact count
+  * is cheap enough.
   */
-  void  Documents::impl::Insert( const impl& docs )
+  bool  Documents::impl::Sample( mtc::api<IQuery> query )
   {
-    auto    exLock = mtc::make_unique_lock( mxLock, std::defer_lock );
+    auto  rBound = query->LastIndex() + 1;
+    auto  nWidth = std::max( rBound / estimate_sections, min_thread_section );
+    auto  nSlice = (rBound + nWidth - 1) / nWidth;
+    auto  nStep = nSlice / estimate_samples;
+
+    if ( nStep < 2 )
+      return false;
 
-  // пересортировать вставляемый контейнер
-    std::sort( docs.Buffer(), docs.Buffer() + docs.nCount, [this]( const Entity& l, const Entity& r )
-      {  return differ( l.id, l.weight, r.id, r.weight ) < 0;  } );
+    auto  actors = Executor::Tasks( async, nlimit );
+    auto  stores = std::vector<mtc::api<impl>>();
+    auto  widths = std::vector<uint32_t>();
+    auto  params = data( *this );
 
-    exLock.lock();
+    params.dwmode = Mode::Count;
+    params.quoter = nullptr;
+    params.facets = nullptr;
+    params.rerank = nullptr;
 
-  // последовательно вставить элементы
-    for ( auto
-      dstptr = Buffer(),
-      dstend = dstptr + nCount,
-      dstlim = dstptr + nLimit,
-      srcptr = docs.Buffer(),
-      srcend = srcptr + docs.nCount; srcptr != srcend; ++srcptr )
+  // the systematic sample of slices starting from the middle of the first step
+    for ( auto slice = nStep / 2; slice < nSlice; slice += nStep )
     {
-      while ( dstptr != dstend && differ( dstptr->id, dstptr->weight, srcptr->id, srcptr->weight ) < 0 )
-        ++dstptr;
+      auto  uLower = slice * nWidth;
+      auto  uUpper = std::min( uLower + nWidth, rBound );
+      auto  sQuery = query->Duplicate( { uLower, uUpper } );
+      auto  pStore = stores.emplace_back( Create( params ) );
+
+      widths.push_back( uUpper - uLower );
+
+      if ( sQuery != nullptr )
+        actors.Insert( [pStore, sQuery](){  pStore->Search( linear, sQuery );  } );
+    }
+
+    actors.Wait();
 
-      if ( dstptr == dstlim )
-        break;
+  // extrapolate the mean slice density with the finite population correction
+    {
+      auto    nCount = size_t(0);
+      double  sumDen = 0.0;
+      double  sumSqr = 0.0;
+      double  fShare = double(stores.size()) / nSlice;
+      double  dCount;
+      double  dError;
 
-      if ( dstend < dstlim )
+      for ( size_t i = 0; i != stores.size(); ++i )
       {
-        quoBox.Set( srcptr->id,
-          *docs.quoBox.Get( srcptr->id ) );
-        memmove( dstptr + 1, dstptr, sizeof(Entity) * (dstend - dstptr) );
-          dstend = ++nCount + Buffer();
+        auto  dDense = double(stores[i]->nFound) / widths[i];
+
+        nCount += stores[i]->nFound;
+        expired |= stores[i]->expired;
+        pStats.tuples += stores[i]->pStats.tuples;
+        pStats.slices += 1;
+        sumDen += dDense;
+        sumSqr += dDense * dDense;
       }
-        else
+
+      sumDen /= stores.size();
+      sumSqr = stores.size() > 1 ? (sumSqr - sumDen * sumDen * stores.size()) / (stores.size() - 1) : 0.0;
+
+      dCount = sumDen * rBound;
+      dError = 1.96 * rBound * sqrt( std::max( sumSqr, 0.0 ) * (1.0 - fShare) / stores.size() );
+
+      nFound = unsigned(std::lround( dCount ));
+      zRange = {
+        { "lower",    uint32_t(std::max( std::lround( dCount - dError ), long(nCount) )) },
+        { "upper",    uint32_t(std::lround( dCount + dError )) },
+        { "sampled",  fShare } };
+    }
+    return true;
+  }
+
+ /*
+  * Follows( id, weight, keys )
+  *
+  * Compares the document to the cursor: positive if placed after the cursor
+  */
+  int   Documents::impl::Follows( uint32_t id, double weight, const uint64_t* keys ) const
+  {
+    return sorter != nullptr ?
+      sorter->Compare( keys, id, weight, kylast.data(), idlast, wtlast ) : differ( id, weight, idlast, wtlast );
+  }
+
+ /*
+  * Order()
+  *
+  * Sorts the documents collected by the order defined
+  */
+  void  Documents::impl::Order()
+  {
+    if ( !sorted )
+      topDoc.Sort(), sorted = true;
+  }
+
+ /*
+  * Quotes( docids )
+  *
+  * Gets the abstracts of the documents selected to be quoted.  The abstracts are not
+  * stored while collecting, so the query is re-run for the selected documents only.
+  */
+  void  Documents::impl::Quotes( std::vector<uint32_t> docids )
+  {
+    auto  subQuery = mtc::api<IQuery>();
+
+    if ( docids.empty() )
+      return;
+
+    std::sort( docids.begin(), docids.end() );
+
+    if ( (subQuery = pQuery->Duplicate( { docids.front(), docids.back() + 1 } )) == nullptr )
+      return;
+
+    for ( auto id: docids )
+      if ( subQuery->SearchDoc( id ) == id )
       {
-        quoBox.Set( srcptr->id,
-          *docs.quoBox.Get( srcptr->id ), dstlim[-1].id );
-        memmove( dstptr + 1, dstptr, sizeof(Entity) * (dstlim - dstptr - 1) );
+        auto  tuples = subQuery->GetTuples( id );
+
+        if ( tuples.dwMode != Abstract::None )
+          quoBox.Set( id, tuples ), ++pStats.quoted;
       }
-      new( dstptr ) Entity( *srcptr );
+  }
+
+ /*
+  * Rerank()
+  *
+  * Weights the best documents of the first phase by the second phase function and
+  * cuts the page.  The abstracts are not stored while collecting, so the query is
+  * re-run for the documents selected, the sections of the docid-ordered list being
+  * reranked in parallel; the query duplicates are created by this thread only.
+  * The documents the second phase does not weight keep the first phase weights,
+  * so they are ranked after all the documents reranked.
+  */
+  void  Documents::impl::Rerank()
+  {
+    if ( rerank == nullptr || dwmode != Mode::Ranked )
+      return;
+
+    auto  tstart = clock_type::now();
+    auto  ncount = (Order(), topDoc.size());
+    auto  ranked = std::vector<std::pair<uint32_t, double>>( ncount );
+    auto  byid = std::vector<unsigned>( ncount );
+    auto  scored = std::vector<char>( ncount );
+    auto  nscore = unsigned(0);
+    auto  actors = Executor::Tasks( async, nlimit );
+    auto  nparts = std::max( 1U, std::min( actors.GetLimit(), ncount / min_rerank_section ) );
+    auto  fcmp = Compare{ differ, sorter.get() };
+    auto  byrank = [&]( const std::pair<uint32_t, double>& l, const std::pair<uint32_t, double>& r )
+      {  return fcmp( l.first, l.second, r.first, r.second ) < 0;  };
+
+    for ( unsigned i = 0; i != ncount; ++i )
+      ranked[i] = { topDoc.GetIds()[i], topDoc.GetWts()[i] }, byid[i] = i;
+
+    std::sort( byid.begin(), byid.end(), [&]( unsigned l, unsigned r )
+      {  return ranked[l].first < ranked[r].first;  } );
+
+    for ( unsigned part = 0; part != nparts && ncount != 0; ++part )
+    {
+      auto  pbeg = byid.data() + size_t(ncount) * part / nparts;
+      auto  pend = byid.data() + size_t(ncount) * (part + 1) / nparts;
+      auto  subQuery = pbeg != pend ?
+        pQuery->Duplicate( { ranked[*pbeg].first, ranked[pend[-1]].first + 1 } ) : nullptr;
+
+      if ( subQuery != nullptr )
+        actors.Insert( [this, &ranked, &scored, subQuery, pbeg, pend]()
+        {
+          for ( auto p = pbeg; p != pend; ++p )
+          {
+            auto& next = ranked[*p];
+
+            if ( subQuery->SearchDoc( next.first ) == next.first )
+            {
+              auto  tuples = subQuery->GetTuples( next.first );
+
+              if ( tuples.dwMode != Abstract::None )
+                next.second = rerank( next.first, next.second, tuples ), scored[*p] = 1;
+            }
+          }
+        } );
     }
-    nFound += docs.nFound;
+
+    actors.Wait();
+
+  // move the reranked documents first, the weights are not comparable
+    for ( unsigned i = 0; i != ncount; ++i )
+      if ( scored[i] )
+        std::swap( ranked[nscore++], ranked[i] );
+
+  // order by the second phase weights and cut the page
+    std::sort( ranked.begin(), ranked.begin() + nscore, byrank );
+    std::sort( ranked.begin() + nscore, ranked.end(), byrank );
+
+    ncount = std::min( ncount, nPaged );
+
+    for ( unsigned i = 0; i != ncount; ++i )
+      DocIds()[i] = ranked[i].first, Weight()[i] = ranked[i].second;
+
+    topDoc.SetSize( ncount );
+    pStats.rerank = Elapsed( tstart );
+  }
+
+ /*
+  * Probe( query )
+  *
+  * Gets the abstract mode of the first document found to select the built-in
+  * ranking for the query; the mode depends on the index contents type, so it is
+  * the same for all the documents
+  */
+  auto  Documents::impl::Probe( mtc::api<IQuery> query ) -> unsigned
+  {
+    auto  subQuery = query->Duplicate( { 0, query->LastIndex() + 1 } );
+    auto  id = subQuery != nullptr ? subQuery->SearchDoc( 1 ) : uint32_t(-1);
+
+    return id != uint32_t(-1) ? unsigned(subQuery->GetTuples( id ).dwMode) : unsigned(Abstract::None);
   }
 
  /*
-  * Performs real search in a query passed
+  * Performs real search in a query passed with the ranking selected
   */
   bool  Documents::impl::Search( linear_t, mtc::api<IQuery> query )
+  {
+    if ( plugin != nullptr )
+      return Search( linear, query, RankPlug( plugin.ptr() ) );
+
+    switch ( rankas )
+    {
+      case Abstract::Rich:  return Search( linear, query, RankRich() );
+      case Abstract::BM25:  return Search( linear, query, RankBM25() );
+      default:              return Search( linear, query, RankFunc{ ranker } );
+    }
+  }
+
+  template <class Ranker>
+  bool  Documents::impl::Search( linear_t, mtc::api<IQuery> query, Ranker rankfn )
   {
     uint32_t  id = 0;
 
-    for ( pQuery = query; (id = query->SearchDoc( id + 1 )) != uint32_t(-1); )
+  // check the limit ends the time
+    if ( expiry != time_point::max() && clock_type::now() >= expiry )
+      return expired = true, nFound != 0;
+
+    for ( unsigned nloop = 0; (id = query->SearchDoc( id + 1 )) != uint32_t(-1); )
     {
+    // periodically check if the time is over
+      if ( (++nloop & 0xff) == 0 && expiry != time_point::max() && clock_type::now() >= expiry )
+        return expired = true, Flush( rankfn ), nFound != 0;
+
+    // check the metadata before the tuples are built
+      if ( filter != nullptr && !filter->Check( id ) )
+        continue;
+
       auto  tuples = query->GetTuples( id );
 
+      ++pStats.tuples;
+
       if ( tuples.dwMode != Abstract::None )
       {
-        auto  weight = ranker( id, tuples );
-
         ++nFound;
 
-        if ( nCount < nLimit )
-        {
-          new ( Buffer() + nCount++ ) Entity{ id, weight };
-          quoBox.Set( id, tuples );
-        }
-          else
-        {
-          // check if worst is defined; detect worst
-          if ( pWorst == nullptr )
-            for ( auto beg = (pWorst = Buffer()) + 1, end = Buffer() + nCount; beg < end; ++beg )
-              if ( differ( pWorst->id, pWorst->weight, beg->id, beg->weight ) < 0 )
-                pWorst = beg;
-
-          // если лучше худшего, то заместить
-          if ( differ( id, weight, pWorst->id, pWorst->weight ) < 0 )
-          {
-            quoBox.Set( id, tuples, pWorst->id );
-            *pWorst = { id, weight };
-            pWorst = nullptr;
-          }
-        }
+        if ( fCount != nullptr )
+          fCount->Add( id );
+
+      // rank the documents unless the matches are counted only
+        if ( dwmode == Mode::Ranked )
+          Rank( id, tuples, rankfn );
       }
     }
-    return nFound != 0;
+    return Flush( rankfn ), nFound != 0;
   }
 
-  auto  Documents::data::GetRange( uint32_t /*id*/, const Abstract& tuples ) -> double
+ /*
+  * Rank( id, tuples, bm25 )
+  *
+  * Buffers the BM25 abstract to the block and scores the block when filled
+  */
+  void  Documents::impl::Rank( uint32_t id, const Abstract& tuples, RankBM25& rankfn )
   {
-    double  weight = 0.0;
+    if ( tuples.dwMode != Abstract::BM25 )
+      return Place( id, GetRange( id, tuples ) );
 
-    switch ( tuples.dwMode )
+    rankfn.block.Add( id, tuples.nWords, tuples.factors.pbeg, tuples.factors.pend );
+
+    if ( rankfn.block.full() )
+      Flush( rankfn );
+  }
+
+ /*
+  * Flush( bm25 )
+  *
+  * Scores the documents buffered and places the ones not worse than the worst
+  * document kept; the floor is used by the default order only
+  */
+  void  Documents::impl::Flush( RankBM25& rankfn )
+  {
+    if ( rankfn.block.size() == 0 )
+      return;
+
+    auto  ranked = topGrp == nullptr && sorter == nullptr && IsDefault( differ );
+    auto  dfloor = ranked && topDoc.limit() != 0 && topDoc.size() == topDoc.limit() ?
+      topDoc.GetWts()[0] : -HUGE_VAL;
+    auto  passed = rankfn.block.Score( dfloor );
+
+    for ( unsigned i = 0; passed != 0; ++i, passed >>= 1 )
+      if ( (passed & 1) != 0 )
+        Place( rankfn.block.GetId( i ), rankfn.block.GetWeight( i ) );
+
+    rankfn.block.clear();
+  }
+
+ /*
+  * Rank( id, tuples, plugin )
+  *
+  * Copies the abstract to the block passed to the ranker plugin when filled
+  */
+  void  Documents::impl::Rank( uint32_t id, const Abstract& tuples, RankPlug& rankfn )
+  {
+    rankfn.copies.Set( id, tuples );
+    rankfn.blocks.push_back( { id, rankfn.copies.Get( id ) } );
+
+    if ( rankfn.blocks.size() == plugin_block_size )
+      Flush( rankfn );
+  }
+
+  void  Documents::impl::Flush( RankPlug& rankfn )
+  {
+    if ( rankfn.blocks.empty() )
+      return;
+
+    rankfn.plugin->Score( rankfn.blocks.data(), rankfn.blocks.size(), rankfn.values );
+
+    for ( size_t i = 0; i != rankfn.blocks.size(); ++i )
+      Place( rankfn.blocks[i].id, rankfn.values[i] );
+
+    rankfn.blocks.clear();
+    rankfn.copies.Clear();
+  }
+
+ /*
+  * Place( id, weight )
+  *
+  * Inserts the document ranked to the groups or the top documents
+  */
+  void  Documents::impl::Place( uint32_t id, double weight )
+  {
+    auto  pkeys = kyNext.data();
+
+  // the groups are ordered by the keys read
+    if ( topGrp != nullptr )
+      return topGrp->Insert( id, weight );
+
+  // pack the sort keys once for the cursor and the top documents
+    if ( nWidth != 0 )
+      sorter->Pack( id, pkeys );
+
+  // skip the documents preceding the cursor
+    if ( hafter && Follows( id, weight, pkeys ) <= 0 )
+      return;
+
+  // если лучше худшего, то заместить
+    if ( topDoc.Accept( id, weight, pkeys ) )
+      topDoc.Insert( id, weight, pkeys );
+  }
+
+ /*
+  * Regroup( query )
+  *
+  * Collects the documents of the groups selected once again if some of them might
+  * have been lost by the bounded grouping; the documents of the other groups are
+  * skipped before the tuples are built.
+  */
+  void  Documents::impl::Regroup( mtc::api<IQuery> query )
+  {
+    auto      subQuery = mtc::api<IQuery>();
+    uint32_t  id = 0;
+
+    if ( topGrp == nullptr || !topGrp->Lossy() || expired )
+      return;
+
+    if ( (subQuery = query->Duplicate( { 0, query->LastIndex() + 1 } )) == nullptr )
+      return;
+
+    topGrp->Close();
+
+    for ( unsigned nloop = 0; (id = subQuery->SearchDoc( id + 1 )) != uint32_t(-1); )
     {
-      case Abstract::Rich:
-        {
-          const Abstract::EntrySet* best = nullptr;
+      if ( (++nloop & 0xff) == 0 && expiry != time_point::max() && clock_type::now() >= expiry )
+        return (void)(expired = true);
 
-          for ( auto p = tuples.entries.pbeg; p < tuples.entries.pend; ++p )
-            if ( best == nullptr || best->weight < p->weight )
-              weight = (best = p)->weight;
+      if ( !topGrp->Has( id ) || (filter != nullptr && !filter->Check( id )) )
+        continue;
 
-          return weight/* / log10( 2 + tuples.nWords )*/;
-        }
-      case Abstract::BM25:
-        weight = 1.0;
+      auto  tuples = subQuery->GetTuples( id );
 
-        for ( auto p = tuples.factors.pbeg; p < tuples.factors.pend; ++p )
-          weight *= (1.0 - p->dblIDF);
-        return tuples.nWords != 0 ? (1.0 - weight) / log( 2 + tuples.nWords ) : 1.0 - weight;
+      ++pStats.tuples;
 
+      if ( tuples.dwMode != Abstract::None )
+        topGrp->Insert( id, ranker( id, tuples ) );
+    }
+  }
+
+  auto  Documents::data::GetRange( uint32_t /*id*/, const Abstract& tuples ) -> double
+  {
+    switch ( tuples.dwMode )
+    {
+      case Abstract::Rich:
+        return GetRich( tuples );
+      case Abstract::BM25:
+        return GetBM25( tuples );
       default:
         throw std::logic_error( "invalid Abstract mode passed @" __FILE__ ":" LINE_STRING );
     }
@@ -355,32 +1158,225 @@ namespace collect {
       params = std::make_shared<data>();
     if ( scale == nullptr )
       throw std::invalid_argument( "'range' has to be a valid RankerFn @" __FILE__ ":" LINE_STRING );
-    return params->ranker = scale, *this;
+    return params->ranker = scale, params->plugin = nullptr, *this;
+  }
+
+  auto  Documents::SetRange( mtc::api<IRanker> plugin ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    if ( plugin == nullptr )
+      throw std::invalid_argument( "'range' has to be a valid IRanker object @" __FILE__ ":" LINE_STRING );
+
+    params->ranker = [plugin]( uint32_t id, const Abstract& tuples )
+      {
+        auto    single = IRanker::Document{ id, &tuples };
+        double  weight;
+
+        return plugin->Score( &single, 1, &weight ), weight;
+      };
+    return params->plugin = plugin, *this;
   }
 
-  auto  Documents::SetQuote( QuotesFn quotes ) -> Documents&
+  auto  Documents::SetRerank( RerankFn rerank, uint32_t ntop ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    if ( rerank == nullptr )
+      throw std::invalid_argument( "'rerank' has to be a valid RerankFn @" __FILE__ ":" LINE_STRING );
+    if ( ntop == 0 || ntop > max_rerank_window )
+      throw std::invalid_argument( "'rerank' window has to be in 1..10000 @" __FILE__ ":" LINE_STRING );
+    return params->rerank = rerank, params->ntop = ntop, *this;
+  }
+
+  auto  Documents::SetQuote( QuotesFn quotes, double tlimit ) -> Documents&
   {
     if ( params == nullptr )
       params = std::make_shared<data>();
     if ( quotes == nullptr )
       throw std::invalid_argument( "'quote' has to be a valid IQuotation object @" __FILE__ ":" LINE_STRING );
-    return params->quoter = quotes, *this;
+    return params->quoter = quotes, params->qtime = tlimit, *this;
+  }
+
+  auto  Documents::SetTimer( time_point tlimit ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->expiry = tlimit, *this;
+  }
+
+  auto  Documents::SetAfter( const std::string& cursor ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    if ( !LoadCursor( cursor, params->idlast, params->wtlast, params->kylast ) )
+      throw std::invalid_argument( "invalid search 'after' cursor @" __FILE__ ":" LINE_STRING );
+    return params->hafter = true, *this;
+  }
+
+  auto  Documents::SetMode( Mode mode ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->dwmode = mode, *this;
+  }
+
+  auto  Documents::SetCheck( std::shared_ptr<const Filter> check ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->filter = check, *this;
+  }
+
+  auto  Documents::SetOrder( std::shared_ptr<const SortKeys> sorter ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->sorter = sorter, *this;
+  }
+
+  auto  Documents::SetFacet( std::shared_ptr<const FacetSpec> facets ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->facets = facets, *this;
+  }
+
+  auto  Documents::SetGroup( std::shared_ptr<const GroupSpec> groups ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->groups = groups, *this;
+  }
+
+  auto  Documents::SetProfile( bool profile ) -> Documents&
+  {
+    if ( params == nullptr )
+      params = std::make_shared<data>();
+    return params->profile = profile, *this;
   }
 
-  auto  Documents::SetAsync( mtc::ThreadPool* actors ) -> Documents&
+  auto  Documents::SetAsync( Executor* actors, unsigned nlimit ) -> Documents&
   {
     if ( params == nullptr )
       params = std::make_shared<data>();
     if ( actors == nullptr )
-      throw std::invalid_argument( "'actor' has to be a valid mtc::ThreadsPool object @" __FILE__ ":" LINE_STRING );
-    return params->async = actors, *this;
+      throw std::invalid_argument( "'actor' has to be a valid Executor object @" __FILE__ ":" LINE_STRING );
+    return params->async = actors, params->nlimit = nlimit, *this;
   }
 
   auto  Documents::Create() -> mtc::api<ICollector>
   {
     if ( params == nullptr )
       params = std::make_shared<data>();
+
+  // the page following the cursor is always the first one
+    if ( params->hafter )
+    {
+      if ( params->kylast.size() != (params->sorter != nullptr ? params->sorter->Width() : 0) )
+        throw std::invalid_argument( "search 'after' cursor does not match the sort order @" __FILE__ ":" LINE_STRING );
+      params->nfirst = 1;
+    }
+
+  // the groups are paged by 'first' and 'count', no cursor is reported
+    if ( params->groups != nullptr && params->hafter )
+      throw std::invalid_argument( "search 'after' cursor is not supported with 'group_by' @" __FILE__ ":" LINE_STRING );
+
+  // counting collectors keep no documents
+    if ( params->dwmode != Mode::Ranked )
+      params->nfirst = 1, params->ncount = 0, params->groups = nullptr, params->rerank = nullptr;
+
+  // the second phase weights are not known to the cursor, the groups and the sort keys
+    if ( params->rerank != nullptr && (params->hafter || params->groups != nullptr || params->sorter != nullptr) )
+      throw std::invalid_argument( "'rerank' is not supported with 'after', 'group_by' and 'sort' @" __FILE__ ":" LINE_STRING );
+
     return impl::Create( *params );
   }
 
+ /*
+  * The cursor is a hex image of the last document on the page: version byte,
+  * document index, the weight and the sort keys if any as little-endian bytes
+  */
+  auto  Documents::MakeCursor( uint32_t id, double weight, const std::vector<uint64_t>& keys ) -> std::string
+  {
+    static const char hexdig[] = "0123456789abcdef";
+    auto              serial = std::vector<uint8_t>{ 1 };
+    auto              putint = [&]( uint64_t value, size_t nbytes )
+      {
+        for ( size_t i = 0; i != nbytes; ++i )
+          serial.push_back( uint8_t(value >> (i * 8)) );
+      };
+    uint64_t          wtbits;
+    std::string       output;
+
+    memcpy( &wtbits, &weight, sizeof(wtbits) );
+
+    putint( id, sizeof(uint32_t) );
+    putint( wtbits, sizeof(uint64_t) );
+
+    if ( !keys.empty() )
+    {
+      putint( keys.size(), 1 );
+
+      for ( auto key: keys )
+        putint( key, sizeof(uint64_t) );
+    }
+
+    for ( auto by: serial )
+      output += hexdig[by >> 4], output += hexdig[by & 0x0f];
+
+    return output;
+  }
+
+  bool  Documents::LoadCursor( const std::string& cursor, uint32_t& id, double& weight, std::vector<uint64_t>& keys )
+  {
+    auto  serial = std::vector<uint8_t>();
+    auto  getint = [&]( size_t offset, size_t nbytes )
+      {
+        uint64_t  value = 0;
+
+        for ( size_t i = 0; i != nbytes; ++i )
+          value |= uint64_t(serial[offset + i]) << (i * 8);
+        return value;
+      };
+    auto  hexval = []( char ch ) -> int
+      {
+        return ch >= '0' && ch <= '9' ? ch - '0' :
+               ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : -1;
+      };
+    uint64_t  wtbits;
+
+    if ( cursor.length() % 2 != 0 )
+      return false;
+
+    for ( size_t i = 0; i != cursor.length(); i += 2 )
+    {
+      auto  hi = hexval( cursor[i + 0] );
+      auto  lo = hexval( cursor[i + 1] );
+
+      if ( hi < 0 || lo < 0 )
+        return false;
+      serial.push_back( uint8_t((hi << 4) | lo) );
+    }
+
+  // check the version and the length of the cursor
+    if ( serial.size() < 13 || serial[0] != 1 )
+      return false;
+
+    if ( serial.size() != 13 && (serial.size() < 14 || serial.size() != 14 + serial[13] * sizeof(uint64_t)) )
+      return false;
+
+    id = uint32_t(getint( 1, sizeof(uint32_t) ));
+    wtbits = getint( 5, sizeof(uint64_t) );
+
+    memcpy( &weight, &wtbits, sizeof(weight) );
+
+    keys.clear();
+
+    for ( size_t i = 14; i < serial.size(); i += sizeof(uint64_t) )
+      keys.push_back( getint( i, sizeof(uint64_t) ) );
+
+    return true;
+  }
+
 }}
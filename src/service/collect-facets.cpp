@@ -0,0 +1,236 @@
+# include "collect-facets.hpp"
+# include "structo/compat.hpp"
+# include <stdexcept>
+# include <algorithm>
+# include <cstring>
+# include <cmath>
+
+namespace palmira {
+namespace collect {
+
+  constexpr uint32_t  max_buckets = 0x10000;
+
+ /*
+  * The histogram interval index of the value; false if out of the int64 range,
+  * i.e. the interval is too small for the value
+  */
+  static  bool  GetBucket( double value, double interval, uint64_t& bucket )
+  {
+    auto  findex = std::floor( value / interval );
+
+    if ( !(std::fabs( findex ) < 9.2e18) )
+      return false;
+    return bucket = uint64_t(int64_t(findex)), true;
+  }
+
+  // FacetSpec implementation
+
+  FacetSpec::FacetSpec( const mtc::zmap& spec, const DocValues& values )
+  {
+    for ( auto& next: spec )
+    {
+      auto    fdspec = next.second.get_zmap();
+      auto    fdname = fdspec != nullptr ? fdspec->get_charstr( "field" ) : nullptr;
+      auto    column = (const DocValues::Column*)nullptr;
+      auto    fdtype = std::string( "terms" );
+      int64_t nlimit = 10;
+      double  interv = 0.0;
+
+      if ( !next.first.is_charstr() || fdspec == nullptr || fdname == nullptr )
+        throw std::invalid_argument( "'facets' have to be { 'name': { 'field': name, ... } } @" __FILE__ ":" LINE_STRING );
+
+      if ( (column = values.GetColumn( *fdname )) == nullptr )
+        throw std::invalid_argument( "facet field '" + *fdname + "' is not declared in 'doc_values' @" __FILE__ ":" LINE_STRING );
+
+      if ( fdspec->get_charstr( "type" ) != nullptr )
+        fdtype = *fdspec->get_charstr( "type" );
+
+      if ( fdtype != "terms" && fdtype != "histogram" )
+        throw std::invalid_argument( "facet 'type' has to be 'terms' or 'histogram' @" __FILE__ ":" LINE_STRING );
+
+    // the histograms report all the intervals up to the limit
+      if ( fdtype == "histogram" )
+        nlimit = max_buckets;
+
+      if ( fdspec->get( "size" ) != nullptr && (!DocValues::GetValue( *fdspec->get( "size" ), nlimit ) || nlimit <= 0) )
+        throw std::invalid_argument( "facet 'size' has to be positive integer @" __FILE__ ":" LINE_STRING );
+
+      if ( fdtype == "histogram" )
+      {
+        if ( column->GetType() == DocValues::Type::String )
+          throw std::invalid_argument( "facet histogram field '" + *fdname + "' has to be numeric @" __FILE__ ":" LINE_STRING );
+
+        if ( fdspec->get( "interval" ) == nullptr || !DocValues::GetValue( *fdspec->get( "interval" ), interv ) || !(interv > 0.0) )
+          throw std::invalid_argument( "facet histogram 'interval' has to be positive number @" __FILE__ ":" LINE_STRING );
+      }
+
+      facets.push_back( { next.first.to_charstr(), column, fdtype == "histogram", uint32_t(std::min( nlimit, int64_t(max_buckets) )), interv } );
+    }
+  }
+
+  // Facets implementation
+
+  Facets::Facets( const FacetSpec& spec ): fspec( spec ), values( spec.facets.size() )
+  {
+  }
+
+  void  Facets::Add( uint32_t id )
+  {
+    for ( size_t i = 0; i != fspec.facets.size(); ++i )
+    {
+      auto& facet = fspec.facets[i];
+      auto  fdkey = key{ 0, 0 };
+
+      switch ( facet.column->GetType() )
+      {
+        case DocValues::Type::Int:
+          {
+            auto  value = facet.column->GetInt( id );
+
+            if ( value == DocValues::Column::null_int )
+              continue;
+            if ( !facet.histogram )
+              fdkey.lo = uint64_t(value);
+            else
+            if ( !GetBucket( double(value), facet.interval, fdkey.lo ) )
+              continue;
+            break;
+          }
+        case DocValues::Type::UInt:
+          {
+            auto  value = facet.column->GetUInt( id );
+
+            if ( value == DocValues::Column::null_uint )
+              continue;
+            if ( !facet.histogram )
+              fdkey.lo = value;
+            else
+            if ( !GetBucket( double(value), facet.interval, fdkey.lo ) )
+              continue;
+            break;
+          }
+        case DocValues::Type::Double:
+          {
+            auto  value = facet.column->GetDouble( id );
+
+            if ( std::isnan( value ) )
+              continue;
+            if ( !facet.histogram )
+              memcpy( &fdkey.lo, &value, sizeof(value) );
+            else
+            if ( !GetBucket( value, facet.interval, fdkey.lo ) )
+              continue;
+            break;
+          }
+        case DocValues::Type::String:
+          {
+            auto  value = facet.column->GetString( id );
+
+            if ( value.empty() )
+              continue;
+            for ( size_t j = 0; j != value.size(); ++j )
+              (j < 8 ? fdkey.hi : fdkey.lo) |= uint64_t(uint8_t(value[j])) << (56 - (j % 8) * 8);
+            break;
+          }
+      }
+      ++values[i][fdkey];
+    }
+  }
+
+  void  Facets::Merge( const Facets& facets )
+  {
+    for ( size_t i = 0; i != values.size(); ++i )
+      for ( auto& next: facets.values[i] )
+        values[i][next.first] += next.second;
+  }
+
+ /*
+  * Report()
+  *
+  * Lists the most frequent values for the terms facets and the most frequent
+  * intervals ascending for the histograms:
+  *   "name": [ { "value": ..., "count": ... }, ... ]
+  * All the intervals are counted and cut to 'size' here only, so the intervals
+  * listed and the counts do not depend on the parallel collectors.
+  */
+  auto  Facets::Report() const -> mtc::zmap
+  {
+    auto  report = mtc::zmap();
+
+    for ( size_t i = 0; i != values.size(); ++i )
+    {
+      auto& facet = fspec.facets[i];
+      auto  counts = std::vector<std::pair<key, uint32_t>>( values[i].begin(), values[i].end() );
+      auto  output = report.set_array_zmap( facet.name );
+
+      auto  ntop = std::min( size_t(facet.size), counts.size() );
+
+      std::partial_sort( counts.begin(), counts.begin() + ntop, counts.end(), [&]( const std::pair<key, uint32_t>& l, const std::pair<key, uint32_t>& r )
+        {
+          if ( l.second != r.second )
+            return l.second > r.second;
+          if ( facet.histogram )
+            return int64_t(l.first.lo) < int64_t(r.first.lo);
+          return l.first.hi != r.first.hi ? l.first.hi < r.first.hi : l.first.lo < r.first.lo;
+        } );
+      counts.resize( ntop );
+
+      if ( facet.histogram )
+      {
+        std::sort( counts.begin(), counts.end(), []( const std::pair<key, uint32_t>& l, const std::pair<key, uint32_t>& r )
+          {  return int64_t(l.first.lo) < int64_t(r.first.lo);  } );
+      }
+
+      for ( auto& next: counts )
+      {
+        output->push_back( {
+          { "value", GetValue( facet, next.first ) },
+          { "count", next.second } } );
+      }
+    }
+    return report;
+  }
+
+  auto  Facets::GetValue( const FacetSpec::facet& facet, const key& k ) const -> mtc::zval
+  {
+    if ( facet.histogram )
+    {
+      auto  lower = int64_t(k.lo) * facet.interval;
+      auto  whole = 0.0;
+
+      if ( facet.column->GetType() != DocValues::Type::Double && std::fpclassify( std::modf( lower, &whole ) ) == FP_ZERO )
+        return int64_t(whole);
+      return lower;
+    }
+
+    switch ( facet.column->GetType() )
+    {
+      case DocValues::Type::Int:
+        return int64_t(k.lo);
+      case DocValues::Type::UInt:
+        return uint64_t(k.lo);
+      case DocValues::Type::Double:
+        {
+          double  value;
+          return memcpy( &value, &k.lo, sizeof(value) ), value;
+        }
+      case DocValues::Type::String:
+        {
+          auto  value = std::string();
+
+          for ( size_t j = 0; j != 16; ++j )
+          {
+            auto  chr = char(uint8_t(((j < 8 ? k.hi : k.lo) >> (56 - (j % 8) * 8)) & 0xff));
+
+            if ( chr == 0 )
+              break;
+            value += chr;
+          }
+          return value;
+        }
+      default:
+        return {};
+    }
+  }
+
+}}
@@ -0,0 +1,90 @@
+# if !defined( __palmira_src_service_collect_facets_hpp__ )
+# define __palmira_src_service_collect_facets_hpp__
+# include "doc-values.hpp"
+# include <mtc/zmap.h>
+# include <unordered_map>
+# include <string>
+# include <vector>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * FacetSpec
+  *
+  * Facets requested by the search 'facets' argument over the doc-values fields:
+  *
+  *   "facets": {
+  *     "authors": { "field": "author", "type": "terms", "size": 10 },
+  *     "decades": { "field": "year", "type": "histogram", "interval": 10 }
+  *   }
+  *
+  * 'terms' counts the documents per field value and reports 'size' most frequent
+  * values; 'histogram' counts the documents per numeric interval and reports up
+  * to 'size' most frequent intervals ascending (65536 by default and at most).
+  */
+  class FacetSpec final
+  {
+    friend class Facets;
+
+    struct facet
+    {
+      std::string               name;
+      const DocValues::Column*  column;
+      bool                      histogram;
+      uint32_t                  size;
+      double                    interval;
+    };
+
+  public:
+    FacetSpec( const mtc::zmap&, const DocValues& );
+
+  protected:
+    std::vector<facet>  facets;
+
+  };
+
+ /*
+  * Facets
+  *
+  * Facet counters of one collector; the values are kept as packed 16-byte keys,
+  * so the counting never allocates the strings.  The partial collectors count
+  * their own sections and are merged after the parallel search.
+  */
+  class Facets final
+  {
+    struct key
+    {
+      uint64_t  hi;
+      uint64_t  lo;
+
+      bool  operator == ( const key& k ) const  {  return hi == k.hi && lo == k.lo;  }
+    };
+
+    struct hash
+    {
+      size_t  operator()( const key& k ) const  {  return size_t((k.hi * 0x9e3779b97f4a7c15ULL) ^ k.lo);  }
+    };
+
+    using counts = std::unordered_map<key, uint32_t, hash>;
+
+  public:
+    Facets( const FacetSpec& );
+
+  public:
+    void  Add( uint32_t id );
+    void  Merge( const Facets& );
+    auto  Report() const -> mtc::zmap;
+
+  protected:
+    auto  GetValue( const FacetSpec::facet&, const key& ) const -> mtc::zval;
+
+  protected:
+    const FacetSpec&    fspec;
+    std::vector<counts> values;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_collect_facets_hpp__
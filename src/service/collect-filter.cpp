@@ -0,0 +1,445 @@
+# include "collect-filter.hpp"
+# include "structo/compat.hpp"
+# include <stdexcept>
+# include <algorithm>
+# include <type_traits>
+# include <limits>
+# include <cmath>
+
+namespace palmira {
+namespace collect {
+
+  static const char* const rangeKeys[] = { "eq", "gt", "gte", "lt", "lte" };
+
+ /*
+  * The IN-list values of any array type
+  */
+  static  auto  GetList( const mtc::zval& list ) -> std::vector<mtc::zval>
+  {
+    auto  values = std::vector<mtc::zval>();
+
+    switch ( list.get_type() )
+    {
+      case mtc::zval::z_array_zval:
+        return *list.get_array_zval();
+      case mtc::zval::z_array_charstr:
+        for ( auto& next: *list.get_array_charstr() ) values.emplace_back( next );
+        break;
+      case mtc::zval::z_array_int32:
+        for ( auto& next: *list.get_array_int32() )   values.emplace_back( next );
+        break;
+      case mtc::zval::z_array_word32:
+        for ( auto& next: *list.get_array_word32() )  values.emplace_back( next );
+        break;
+      case mtc::zval::z_array_int64:
+        for ( auto& next: *list.get_array_int64() )   values.emplace_back( next );
+        break;
+      case mtc::zval::z_array_word64:
+        for ( auto& next: *list.get_array_word64() )  values.emplace_back( next );
+        break;
+      case mtc::zval::z_array_double:
+        for ( auto& next: *list.get_array_double() )  values.emplace_back( next );
+        break;
+      default:
+        throw std::invalid_argument( "filter 'in' has to be an array of values @" __FILE__ ":" LINE_STRING );
+    }
+    return values;
+  }
+
+  template <class T>
+  static  auto  GetValue( const mtc::zval& value ) -> T
+  {
+    T       out;
+    double  sig;
+
+    if ( !DocValues::GetValue( value, sig ) )
+      throw std::invalid_argument( "filter value has to be numeric for the numeric field @" __FILE__ ":" LINE_STRING );
+
+  // the negative values are rejected before the conversion to unsigned
+    if ( std::is_unsigned<T>::value && sig < 0.0 )
+      throw std::invalid_argument( "filter value has to be non-negative for the unsigned field @" __FILE__ ":" LINE_STRING );
+
+    return DocValues::GetValue( value, out ), out;
+  }
+
+ /*
+  * GetBound( value, oper, bound )
+  *
+  * Converts the filter value to the closed bound of the integer field for the range
+  * operator: the fractional values are rounded up for 'gt' and 'gte', down for 'lt'
+  * and 'lte', and match nothing for 'eq'; the values out of the field type range are
+  * clamped.  Returns false if no field value matches the operator.
+  */
+  enum class Bound: unsigned {  eq, gt, gte, lt, lte  };   // the order of rangeKeys
+
+  template <class T>
+  static  bool  GetBound( const mtc::zval& value, Bound oper, T& bound )
+  {
+    constexpr auto  minval = std::numeric_limits<T>::min();
+    constexpr auto  maxval = std::numeric_limits<T>::max();
+    auto            dvalue = GetValue<double>( value );
+    auto            ivalue = T();
+    auto            fvalue = 0.0;
+
+    if ( std::isnan( dvalue ) )
+      throw std::invalid_argument( "filter value has to be a number @" __FILE__ ":" LINE_STRING );
+
+    if ( std::is_unsigned<T>::value && dvalue < 0.0 )
+      throw std::invalid_argument( "filter value has to be non-negative for the unsigned field @" __FILE__ ":" LINE_STRING );
+
+  // the integer values are exact unless out of the field type range
+    if ( value.get_type() != mtc::zval::z_float && value.get_type() != mtc::zval::z_double )
+    {
+      if ( std::is_signed<T>::value && value.get_type() == mtc::zval::z_word64 && *value.get_word64() > uint64_t(maxval) )
+        return oper == Bound::lt || oper == Bound::lte ? (bound = maxval, true) : false;
+
+      switch ( DocValues::GetValue( value, ivalue ), oper )
+      {
+        case Bound::gt:   return ivalue != maxval ? (bound = ivalue + 1, true) : false;
+        case Bound::lt:   return ivalue != minval ? (bound = ivalue - 1, true) : false;
+        default:          return bound = ivalue, true;
+      }
+    }
+
+  // the fractional values are rounded by the operator; 2^digits is the exact double
+  // upper limit of the type, the lower one is 0 or -2^digits
+    auto  uLimit = std::ldexp( 1.0, std::numeric_limits<T>::digits );
+    auto  lLimit = double(minval);
+
+    switch ( oper )
+    {
+      case Bound::eq:
+        if ( std::fpclassify( std::modf( dvalue, &fvalue ) ) != FP_ZERO || !(fvalue >= lLimit && fvalue < uLimit) )
+          return false;
+        return bound = T(fvalue), true;
+      case Bound::gt:
+      case Bound::gte:
+        fvalue = oper == Bound::gt ? std::floor( dvalue ) + 1.0 : std::ceil( dvalue );
+        if ( !(fvalue < uLimit) )
+          return false;
+        return bound = fvalue >= lLimit ? T(fvalue) : minval, true;
+      case Bound::lt:
+      case Bound::lte:
+        fvalue = oper == Bound::lt ? std::ceil( dvalue ) - 1.0 : std::floor( dvalue );
+        if ( !(fvalue >= lLimit) )
+          return false;
+        return bound = fvalue < uLimit ? T(fvalue) : maxval, true;
+    }
+    return false;
+  }
+
+ /*
+  * SetRange( clause, lo, hi )
+  *
+  * Narrows the closed range of the integer field by the range operators; the empty
+  * range is kept as lo > hi
+  */
+  template <class T>
+  static  void  SetRange( const mtc::zmap& clause, T& lo, T& hi )
+  {
+    auto  nomatch = false;
+
+    for ( auto oper: { Bound::eq, Bound::gt, Bound::gte, Bound::lt, Bound::lte } )
+    {
+      auto  pvalue = clause.get( rangeKeys[unsigned(oper)] );
+      auto  bound = T();
+
+      if ( pvalue == nullptr )
+        continue;
+
+      if ( !GetBound( *pvalue, oper, bound ) )
+        nomatch = true;
+      else
+      if ( oper == Bound::eq )
+        lo = std::max( lo, bound ), hi = std::min( hi, bound );
+      else
+      if ( oper == Bound::gt || oper == Bound::gte )
+        lo = std::max( lo, bound );
+      else
+        hi = std::min( hi, bound );
+    }
+    if ( nomatch )
+      lo = 1, hi = 0;
+  }
+
+  // Filter implementation
+
+  Filter::Filter( const mtc::zmap& filter, const DocValues& docval ): values( docval )
+  {
+    Compile( filter );
+  }
+
+  bool  Filter::Check( const node& op, uint32_t id ) const
+  {
+    switch ( op.action )
+    {
+      case op_and:
+        for ( auto p = operand.data() + op.offset, e = p + op.length; p != e; ++p )
+          if ( !Check( program[*p], id ) )
+            return false;
+        return true;
+      case op_or:
+        for ( auto p = operand.data() + op.offset, e = p + op.length; p != e; ++p )
+          if ( Check( program[*p], id ) )
+            return true;
+        return false;
+      case op_not:
+        return !Check( program[operand[op.offset]], id );
+      case op_int_range:
+        {
+          auto  value = op.column->GetInt( id );
+          return value != DocValues::Column::null_int && value >= op.lo.i && value <= op.hi.i;
+        }
+      case op_uint_range:
+        {
+          auto  value = op.column->GetUInt( id );
+          return value != DocValues::Column::null_uint && value >= op.lo.u && value <= op.hi.u;
+        }
+      case op_double_range:
+        {
+          auto  value = op.column->GetDouble( id );
+          return value >= op.lo.d && value <= op.hi.d;    // NaN never matches
+        }
+      case op_int_in:
+        {
+          auto  value = op.column->GetInt( id );
+          return value != DocValues::Column::null_int
+            && std::binary_search( intset.begin() + op.offset, intset.begin() + op.offset + op.length, value );
+        }
+      case op_uint_in:
+        {
+          auto  value = op.column->GetUInt( id );
+          return value != DocValues::Column::null_uint
+            && std::binary_search( uinset.begin() + op.offset, uinset.begin() + op.offset + op.length, value );
+        }
+      case op_double_in:
+        {
+          auto  value = op.column->GetDouble( id );
+          return std::binary_search( dblset.begin() + op.offset, dblset.begin() + op.offset + op.length, value );
+        }
+      case op_string_in:
+        {
+          auto  value = op.column->GetString( id );
+          return !value.empty()
+            && std::binary_search( strset.begin() + op.offset, strset.begin() + op.offset + op.length, value, std::less<>() );
+        }
+    }
+    return false;
+  }
+
+  auto  Filter::Compile( const mtc::zmap& clause ) -> uint32_t
+  {
+    const mtc::zval*  pval;
+
+    if ( (pval = clause.get( "and" )) != nullptr )
+      return CompileList( op_and, *pval );
+
+    if ( (pval = clause.get( "or" )) != nullptr )
+      return CompileList( op_or, *pval );
+
+    if ( (pval = clause.get( "not" )) != nullptr )
+    {
+      if ( pval->get_zmap() == nullptr )
+        throw std::invalid_argument( "filter 'not' has to be a filter clause @" __FILE__ ":" LINE_STRING );
+
+      operand.push_back( Compile( *pval->get_zmap() ) );
+
+      return Append( { op_not, nullptr, uint32_t(operand.size() - 1), 1 } );
+    }
+    return CompileField( clause );
+  }
+
+  auto  Filter::CompileList( opcode action, const mtc::zval& list ) -> uint32_t
+  {
+    auto  childs = std::vector<uint32_t>();
+
+    if ( list.get_array_zmap() != nullptr )
+    {
+      for ( auto& next: *list.get_array_zmap() )
+        childs.push_back( Compile( next ) );
+    }
+      else
+    if ( list.get_array_zval() != nullptr )
+    {
+      for ( auto& next: *list.get_array_zval() )
+        if ( next.get_zmap() != nullptr ) childs.push_back( Compile( *next.get_zmap() ) );
+          else throw std::invalid_argument( "filter 'and', 'or' have to be arrays of filter clauses @" __FILE__ ":" LINE_STRING );
+    }
+      else
+    throw std::invalid_argument( "filter 'and', 'or' have to be arrays of filter clauses @" __FILE__ ":" LINE_STRING );
+
+    if ( childs.empty() )
+      throw std::invalid_argument( "filter 'and', 'or' have to be non-empty @" __FILE__ ":" LINE_STRING );
+
+    operand.insert( operand.end(), childs.begin(), childs.end() );
+
+    return Append( { action, nullptr, uint32_t(operand.size() - childs.size()), uint32_t(childs.size()) } );
+  }
+
+ /*
+  * CompileField( clause )
+  *
+  * Compiles the conditions for one field; several conditions are joined by 'and'
+  */
+  auto  Filter::CompileField( const mtc::zmap& clause ) -> uint32_t
+  {
+    auto  fdname = clause.get_charstr( "field" );
+    auto  column = (const DocValues::Column*)nullptr;
+    auto  childs = std::vector<uint32_t>();
+    auto  pvalue = (const mtc::zval*)nullptr;
+
+    if ( fdname == nullptr )
+      throw std::invalid_argument( "filter clause has to be 'and', 'or', 'not' or define the 'field' @" __FILE__ ":" LINE_STRING );
+
+    if ( (column = values.GetColumn( *fdname )) == nullptr )
+      throw std::invalid_argument( "filter field '" + *fdname + "' is not declared in 'doc_values' @" __FILE__ ":" LINE_STRING );
+
+  // range conditions
+    if ( std::any_of( std::begin( rangeKeys ), std::end( rangeKeys ), [&]( const char* key ){  return clause.get( key ) != nullptr;  } ) )
+    {
+      if ( column->GetType() != DocValues::Type::String )
+        childs.push_back( CompileRange( column, clause ) );
+      else
+      if ( std::any_of( std::begin( rangeKeys ) + 1, std::end( rangeKeys ), [&]( const char* key ){  return clause.get( key ) != nullptr;  } ) )
+        throw std::invalid_argument( "filter ranges are not supported for string field '" + *fdname + "' @" __FILE__ ":" LINE_STRING );
+      else
+        childs.push_back( CompileIn( column, { *clause.get( "eq" ) } ) );
+    }
+
+  // IN-lists
+    if ( (pvalue = clause.get( "in" )) != nullptr )
+      childs.push_back( CompileIn( column, GetList( *pvalue ) ) );
+
+  // inequality as negated IN-list of one element
+    if ( (pvalue = clause.get( "ne" )) != nullptr )
+    {
+      operand.push_back( CompileIn( column, { *pvalue } ) );
+      childs.push_back( Append( { op_not, nullptr, uint32_t(operand.size() - 1), 1 } ) );
+    }
+
+    if ( childs.empty() )
+      throw std::invalid_argument( "filter field '" + *fdname + "' has no conditions @" __FILE__ ":" LINE_STRING );
+
+    if ( childs.size() == 1 )
+      return childs.front();
+
+    operand.insert( operand.end(), childs.begin(), childs.end() );
+
+    return Append( { op_and, nullptr, uint32_t(operand.size() - childs.size()), uint32_t(childs.size()) } );
+  }
+
+ /*
+  * CompileRange( column, clause )
+  *
+  * Builds the closed range of the values; the empty range is kept as lo > hi
+  */
+  auto  Filter::CompileRange( const DocValues::Column* column, const mtc::zmap& clause ) -> uint32_t
+  {
+    auto  getval = [&]( const char* key ) -> const mtc::zval*
+      {  return clause.get( key );  };
+    auto  action = node{ op_int_range, column, 0, 0 };
+
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        {
+          auto  lo = std::numeric_limits<int64_t>::min() + 1;   // min is null
+          auto  hi = std::numeric_limits<int64_t>::max();
+
+          SetRange( clause, lo, hi );
+
+          action.action = op_int_range;
+          action.lo.i = lo;
+          action.hi.i = hi;
+          break;
+        }
+      case DocValues::Type::UInt:
+        {
+          auto  lo = std::numeric_limits<uint64_t>::min();
+          auto  hi = std::numeric_limits<uint64_t>::max() - 1;  // max is null
+
+          SetRange( clause, lo, hi );
+
+          action.action = op_uint_range;
+          action.lo.u = lo;
+          action.hi.u = hi;
+          break;
+        }
+      case DocValues::Type::Double:
+        {
+          auto  lo = -std::numeric_limits<double>::infinity();
+          auto  hi = std::numeric_limits<double>::infinity();
+
+          if ( getval( "eq" ) != nullptr )
+            lo = std::max( lo, GetValue<double>( *getval( "eq" ) ) ), hi = std::min( hi, GetValue<double>( *getval( "eq" ) ) );
+          if ( getval( "gte" ) != nullptr )
+            lo = std::max( lo, GetValue<double>( *getval( "gte" ) ) );
+          if ( getval( "lte" ) != nullptr )
+            hi = std::min( hi, GetValue<double>( *getval( "lte" ) ) );
+          if ( getval( "gt" ) != nullptr )
+            lo = std::max( lo, std::nextafter( GetValue<double>( *getval( "gt" ) ), hi + 1.0 ) );
+          if ( getval( "lt" ) != nullptr )
+            hi = std::min( hi, std::nextafter( GetValue<double>( *getval( "lt" ) ), lo - 1.0 ) );
+
+          action.action = op_double_range;
+          action.lo.d = lo;
+          action.hi.d = hi;
+          break;
+        }
+      default:
+        throw std::logic_error( "unexpected field type @" __FILE__ ":" LINE_STRING );
+    }
+    return Append( action );
+  }
+
+ /*
+  * CompileIn( column, list )
+  *
+  * Stores the sorted unique values to the typed set of the filter
+  */
+  auto  Filter::CompileIn( const DocValues::Column* column, const std::vector<mtc::zval>& list ) -> uint32_t
+  {
+    auto  addset = [&]( auto& valset, auto&& getval, opcode action ) -> uint32_t
+      {
+        auto  offset = valset.size();
+
+        for ( auto& next: list )
+        {
+          auto  value = typename std::decay<decltype(valset)>::type::value_type();
+
+          if ( getval( next, value ) )
+            valset.push_back( std::move( value ) );
+        }
+
+        std::sort( valset.begin() + offset, valset.end() );
+          valset.erase( std::unique( valset.begin() + offset, valset.end() ), valset.end() );
+
+        return Append( { action, column, uint32_t(offset), uint32_t(valset.size() - offset) } );
+      };
+
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        return addset( intset, []( const mtc::zval& value, int64_t& out ){  return GetBound( value, Bound::eq, out );  }, op_int_in );
+      case DocValues::Type::UInt:
+        return addset( uinset, []( const mtc::zval& value, uint64_t& out ){  return GetBound( value, Bound::eq, out );  }, op_uint_in );
+      case DocValues::Type::Double:
+        return addset( dblset, []( const mtc::zval& value, double& out ){  return out = GetValue<double>( value ), true;  }, op_double_in );
+      case DocValues::Type::String:
+        return addset( strset, []( const mtc::zval& value, std::string& out )
+          {
+            if ( value.get_charstr() == nullptr && value.get_widestr() == nullptr )
+              throw std::invalid_argument( "filter value has to be string for the string field @" __FILE__ ":" LINE_STRING );
+            return out = DocValues::GetString( value ), true;
+          }, op_string_in );
+      default:
+        throw std::logic_error( "unexpected field type @" __FILE__ ":" LINE_STRING );
+    }
+  }
+
+  auto  Filter::Append( const node& op ) -> uint32_t
+  {
+    return program.push_back( op ), uint32_t(program.size() - 1);
+  }
+
+}}
@@ -0,0 +1,83 @@
+# if !defined( __palmira_src_service_collect_filter_hpp__ )
+# define __palmira_src_service_collect_filter_hpp__
+# include "doc-values.hpp"
+# include <mtc/zmap.h>
+# include <string>
+# include <vector>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * Filter
+  *
+  * Metadata predicate compiled from the search 'filter' clause to the flat program
+  * over the doc-values columns, so the check costs a few loads per document:
+  *
+  *   { "field": "year", "gte": 1990, "lt": 2000 }          ranges: gt, gte, lt, lte
+  *   { "field": "year", "eq": 1999 }                       equality: eq, ne
+  *   { "field": "author", "in": [ "Pushkin", "Gogol" ] }   IN-lists
+  *   { "and": [ ... ] }, { "or": [ ... ] }, { "not": { ... } }
+  *
+  * Documents having no value for the field never match the field conditions but 'ne'.
+  */
+  class Filter final
+  {
+    enum opcode: uint8_t
+    {
+      op_and,
+      op_or,
+      op_not,
+      op_int_range,
+      op_uint_range,
+      op_double_range,
+      op_int_in,
+      op_uint_in,
+      op_double_in,
+      op_string_in
+    };
+
+    struct node
+    {
+      opcode                    action;
+      const DocValues::Column*  column;
+      uint32_t                  offset;   // the first operand or value
+      uint32_t                  length;   // count of operands or values
+      union
+      {
+        int64_t   i;
+        uint64_t  u;
+        double    d;
+      }                         lo = {}, hi = {};
+    };
+
+  public:
+    Filter( const mtc::zmap&, const DocValues& );
+
+  public:
+    bool  Check( uint32_t id ) const  {  return Check( program.back(), id );  }
+
+  protected:
+    bool  Check( const node&, uint32_t ) const;
+
+    auto  Compile( const mtc::zmap& ) -> uint32_t;
+    auto  CompileList( opcode, const mtc::zval& ) -> uint32_t;
+    auto  CompileField( const mtc::zmap& ) -> uint32_t;
+    auto  CompileRange( const DocValues::Column*, const mtc::zmap& ) -> uint32_t;
+    auto  CompileIn( const DocValues::Column*, const std::vector<mtc::zval>& ) -> uint32_t;
+    auto  Append( const node& ) -> uint32_t;
+
+  protected:
+    const DocValues&          values;
+    std::vector<node>         program;    // operands precede the operation, the root is the last
+    std::vector<uint32_t>     operand;
+    std::vector<int64_t>      intset;
+    std::vector<uint64_t>     uinset;
+    std::vector<double>       dblset;
+    std::vector<std::string>  strset;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_collect_filter_hpp__
@@ -0,0 +1,101 @@
+# include "collect-groups.hpp"
+# include "structo/compat.hpp"
+# include <stdexcept>
+# include <cstring>
+# include <cmath>
+
+namespace palmira {
+namespace collect {
+
+  GroupSpec::GroupSpec( const std::string& field, int32_t size, const DocValues& values ):
+    column( values.GetColumn( field ) ),
+    nitems( unsigned(size) )
+  {
+    if ( column == nullptr )
+      throw std::invalid_argument( "'group_by' field '" + field + "' is not declared in 'doc_values' @" __FILE__ ":" LINE_STRING );
+    if ( size <= 0 || size > 0x400 )
+      throw std::invalid_argument( "'group_size' has to be in 1..1024 @" __FILE__ ":" LINE_STRING );
+  }
+
+ /*
+  * GetKey( id )
+  *
+  * Packs the field value to the group key; the documents having no value get
+  * the key no value may be packed to
+  */
+  auto  GroupSpec::GetKey( uint32_t id ) const -> key
+  {
+    auto  gkey = key{ 0, 0 };
+
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        {
+          auto  value = column->GetInt( id );
+
+          if ( value == DocValues::Column::null_int )
+            break;
+          return gkey.lo = uint64_t(value), gkey;
+        }
+      case DocValues::Type::UInt:
+        {
+          auto  value = column->GetUInt( id );
+
+          if ( value == DocValues::Column::null_uint )
+            break;
+          return gkey.lo = value, gkey;
+        }
+      case DocValues::Type::Double:
+        {
+          auto  value = column->GetDouble( id );
+
+          if ( std::isnan( value ) )
+            break;
+          return memcpy( &gkey.lo, &value, sizeof(value) ), gkey;
+        }
+      case DocValues::Type::String:
+        {
+          auto  value = column->GetString( id );
+
+          if ( value.empty() )
+            break;
+
+          for ( size_t i = 0; i != value.size(); ++i )
+            (i < 8 ? gkey.hi : gkey.lo) |= uint64_t(uint8_t(value[i])) << (56 - (i % 8) * 8);
+
+          return gkey;
+        }
+    }
+    return { ~uint64_t(0), ~uint64_t(0) };
+  }
+
+  auto  GroupSpec::GetValue( uint32_t id ) const -> mtc::zval
+  {
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        {
+          auto  value = column->GetInt( id );
+          return value != DocValues::Column::null_int ? mtc::zval( value ) : mtc::zval();
+        }
+      case DocValues::Type::UInt:
+        {
+          auto  value = column->GetUInt( id );
+          return value != DocValues::Column::null_uint ? mtc::zval( value ) : mtc::zval();
+        }
+      case DocValues::Type::Double:
+        {
+          auto  value = column->GetDouble( id );
+          return !std::isnan( value ) ? mtc::zval( value ) : mtc::zval();
+        }
+      case DocValues::Type::String:
+        {
+          auto  value = column->GetString( id );
+          return !value.empty() ? mtc::zval( std::string( value ) ) : mtc::zval();
+        }
+      default:
+        return {};
+    }
+  }
+
+}}
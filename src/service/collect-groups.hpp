@@ -0,0 +1,307 @@
+# if !defined( __palmira_src_service_collect_groups_hpp__ )
+# define __palmira_src_service_collect_groups_hpp__
+# include "doc-values.hpp"
+# include <mtc/zmap.h>
+# include <unordered_map>
+# include <algorithm>
+# include <bitset>
+# include <string>
+# include <vector>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * GroupSpec
+  *
+  * Field collapsing requested by the search order arguments:
+  *
+  *   "group_by": "author", "group_size": 3
+  *
+  * The documents are grouped by the value of the doc-values field, the groups are
+  * ordered by the best document and paged as the documents are; each group lists
+  * 'group_size' best documents.  Documents having no value form one group.
+  */
+  class GroupSpec final
+  {
+  public:
+    struct key
+    {
+      uint64_t  hi;
+      uint64_t  lo;
+
+      bool  operator == ( const key& k ) const  {  return hi == k.hi && lo == k.lo;  }
+    };
+
+    struct hash
+    {
+      size_t  operator()( const key& k ) const  {  return size_t((k.hi * 0x9e3779b97f4a7c15ULL) ^ k.lo);  }
+    };
+
+  public:
+    GroupSpec( const std::string& field, int32_t size, const DocValues& );
+
+  public:
+    auto  GetSize() const -> unsigned {  return nitems;  }
+    auto  GetKey( uint32_t id ) const -> key;
+    auto  GetValue( uint32_t id ) const -> mtc::zval;
+
+  protected:
+    const DocValues::Column*  column;
+    unsigned                  nitems;
+
+  };
+
+ /*
+  * TopGroups<Differ>
+  *
+  * The best groups of documents found, bounded by the count of groups and the count
+  * of documents in a group, so the memory used does not depend on the count found.
+  *
+  * A group is ranked by it's best document; a new group replaces the worst one if
+  * it's document is better.  The documents of the groups dropped are lost, so the
+  * keys dropped are marked in a small bitmap: if a group kept might have lost some
+  * of it's documents, Lossy() reports it, and the owner has to collect the groups
+  * selected once again by Close() and Insert() for the exact lists and counts.
+  *
+  * Differ( d1, f1, d2, f2 ) returns negative value if (d1, f1) has to be placed before
+  * (d2, f2), i.e. is better.
+  */
+  template <class Differ>
+  class TopGroups
+  {
+    using key = GroupSpec::key;
+    using doc = std::pair<uint32_t, double>;
+
+    enum: size_t {  dropped_bits = 0x1000  };
+
+  public:
+    struct Group
+    {
+      key               gkey;
+      unsigned          found;
+      std::vector<doc>  items;    // the best item is the first one after Sort()
+      doc               first;    // the best item
+    };
+
+  public:
+    TopGroups( const GroupSpec& spec, unsigned limit, Differ fcmp ):
+      gspecs( spec ),
+      nlimit( limit ),
+      differ( fcmp ) {}
+
+  public:
+    auto  size() const -> unsigned  {  return unsigned(groups.size());  }
+    auto  operator []( size_t i ) const -> const Group& {  return groups[i];  }
+
+   /*
+    * Has( id )
+    *
+    * Checks if the group of the document is kept
+    */
+    bool  Has( uint32_t id ) const
+    {
+      return keymap.find( gspecs.GetKey( id ) ) != keymap.end();
+    }
+
+   /*
+    * Insert( id, weight )
+    *
+    * Inserts the document to it's group if the group is kept or may be kept
+    */
+    void  Insert( uint32_t id, double wt )
+    {
+      auto  gkey = gspecs.GetKey( id );
+      auto  ppos = keymap.find( gkey );
+
+      if ( ppos != keymap.end() )
+        return AddItem( ppos->second, id, wt );
+
+    // the groups collected once again accept the documents of the groups selected only
+      if ( closed || nlimit == 0 )
+        return;
+
+      if ( groups.size() < nlimit )
+      {
+        keymap.emplace( gkey, groups.size() );
+        groups.push_back( { gkey, 0, {}, { id, wt } } );
+
+        if ( groups.size() == 1 || IsWorse( groups.back().first, groups[iworst].first ) )
+          iworst = groups.size() - 1;
+      }
+        else
+      if ( IsWorse( groups[iworst].first, { id, wt } ) )
+      {
+        Dropped( groups[iworst].gkey );
+        keymap.erase( groups[iworst].gkey );
+        keymap.emplace( gkey, iworst );
+        groups[iworst] = { gkey, 0, {}, { id, wt } };
+        FindWorst();
+      }
+        else
+      return Dropped( gkey );
+
+      AddItem( keymap[gkey], id, wt );
+    }
+
+   /*
+    * Merge( groups )
+    *
+    * Merges the groups collected by the partial collector
+    */
+    void  Merge( const TopGroups& other )
+    {
+      dropped |= other.dropped;
+
+      for ( auto& next: other.groups )
+      {
+        auto  ppos = keymap.find( next.gkey );
+
+        if ( ppos == keymap.end() )
+        {
+          if ( groups.size() < nlimit )
+          {
+            keymap.emplace( next.gkey, groups.size() );
+            groups.push_back( { next.gkey, 0, {}, next.first } );
+          }
+            else
+          if ( IsWorse( groups[iworst].first, next.first ) )
+          {
+            Dropped( groups[iworst].gkey );
+            keymap.erase( groups[iworst].gkey );
+            keymap.emplace( next.gkey, iworst );
+            groups[iworst] = { next.gkey, 0, {}, next.first };
+          }
+            else
+          {
+            Dropped( next.gkey );
+            continue;
+          }
+          ppos = keymap.find( next.gkey );
+        }
+        for ( auto& item: next.items )
+          AddItem( ppos->second, item.first, item.second );
+
+        groups[ppos->second].found += next.found - unsigned(next.items.size());
+        FindWorst();
+      }
+    }
+
+   /*
+    * Lossy()
+    *
+    * Checks if any group kept might have lost some of it's documents
+    */
+    bool  Lossy() const
+    {
+      for ( auto& next: groups )
+        if ( dropped.test( GroupSpec::hash()( next.gkey ) % dropped_bits ) )
+          return true;
+      return false;
+    }
+
+   /*
+    * Close()
+    *
+    * Clears the documents of the groups kept and fixes the set of the groups, so
+    * the documents of these groups only are inserted then
+    */
+    void  Close()
+    {
+      for ( auto& next: groups )
+        next.found = 0, next.items.clear();
+
+      dropped.reset();
+      closed = true;
+    }
+
+   /*
+    * Sort()
+    *
+    * Orders the groups by the best documents and the documents in each group
+    */
+    void  Sort()
+    {
+      auto  better = [this]( const doc& l, const doc& r ){  return IsWorse( r, l );  };
+
+      for ( auto& next: groups )
+        std::sort( next.items.begin(), next.items.end(), better );
+
+      std::sort( groups.begin(), groups.end(), [&]( const Group& l, const Group& r )
+        {  return better( l.first, r.first );  } );
+
+      for ( size_t i = 0; i != groups.size(); ++i )
+        keymap[groups[i].gkey] = i;
+    }
+
+  protected:
+    bool  IsWorse( const doc& l, const doc& r ) const
+      {  return differ( l.first, l.second, r.first, r.second ) > 0;  }
+
+    void  Dropped( const key& gkey )
+      {  dropped.set( GroupSpec::hash()( gkey ) % dropped_bits );  }
+
+    void  FindWorst()
+    {
+      iworst = 0;
+
+      for ( size_t i = 1; i < groups.size(); ++i )
+        if ( IsWorse( groups[i].first, groups[iworst].first ) )
+          iworst = i;
+    }
+
+   /*
+    * AddItem( group, id, weight )
+    *
+    * Keeps the document if one of the best in the group and updates the best one
+    */
+    void  AddItem( size_t npos, uint32_t id, double wt )
+    {
+      auto& group = groups[npos];
+      auto  item = doc{ id, wt };
+
+      ++group.found;
+
+      if ( group.items.size() < gspecs.GetSize() )
+      {
+        group.items.push_back( item );
+      }
+        else
+      {
+        auto  pworst = group.items.begin();
+
+        for ( auto p = pworst + 1; p != group.items.end(); ++p )
+          if ( IsWorse( *p, *pworst ) )
+            pworst = p;
+
+        if ( !IsWorse( *pworst, item ) )
+          return;
+
+        *pworst = item;
+      }
+
+    // the best document of the worst group improved: find the new worst group
+      if ( IsWorse( group.first, item ) )
+      {
+        group.first = item;
+
+        if ( npos == iworst )
+          FindWorst();
+      }
+    }
+
+  protected:
+    const GroupSpec&  gspecs;
+    const unsigned    nlimit;
+    Differ            differ;
+    std::vector<Group>  groups;
+    std::unordered_map<key, size_t, GroupSpec::hash> keymap;
+    std::bitset<dropped_bits> dropped;
+    size_t            iworst = 0;
+    bool              closed = false;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_collect_groups_hpp__
@@ -0,0 +1,58 @@
+# include "collect-order.hpp"
+# include "structo/compat.hpp"
+# include <stdexcept>
+
+namespace palmira {
+namespace collect {
+
+  SortKeys::SortKeys( const mtc::zval& order, const DocValues& values )
+  {
+    auto  addkey = [&]( const mtc::zmap& sortby )
+      {
+        auto  fdname = sortby.get_charstr( "field" );
+        auto  direct = sortby.get_charstr( "order", "asc" );
+        auto  column = (const DocValues::Column*)nullptr;
+
+        if ( fdname == nullptr )
+          throw std::invalid_argument( "'sort' key has to define the 'field' @" __FILE__ ":" LINE_STRING );
+
+        if ( (column = values.GetColumn( *fdname )) == nullptr )
+          throw std::invalid_argument( "'sort' field '" + *fdname + "' is not declared in 'doc_values' @" __FILE__ ":" LINE_STRING );
+
+        if ( direct != "asc" && direct != "desc" )
+          throw std::invalid_argument( "'sort' order has to be 'asc' or 'desc' @" __FILE__ ":" LINE_STRING );
+
+        fields.push_back( { column, direct == "desc" } );
+          nwords += column->GetType() == DocValues::Type::String ? 2 : 1;
+      };
+
+    if ( order.get_zmap() != nullptr )
+      addkey( *order.get_zmap() );
+    else
+    if ( order.get_array_zmap() != nullptr )
+    {
+      for ( auto& next: *order.get_array_zmap() )
+        addkey( next );
+    }
+      else
+    if ( order.get_array_zval() != nullptr )
+    {
+      for ( auto& next: *order.get_array_zval() )
+        if ( next.get_zmap() != nullptr ) addkey( *next.get_zmap() );
+          else throw std::invalid_argument( "'sort' has to be an array of { 'field': name, 'order': 'asc' | 'desc' } @" __FILE__ ":" LINE_STRING );
+    }
+      else
+    throw std::invalid_argument( "'sort' has to be an array of { 'field': name, 'order': 'asc' | 'desc' } @" __FILE__ ":" LINE_STRING );
+
+    if ( fields.empty() )
+      throw std::invalid_argument( "'sort' has to define at least one field @" __FILE__ ":" LINE_STRING );
+  }
+
+  auto  SortKeys::GetKeys( uint32_t id ) const -> std::vector<uint64_t>
+  {
+    auto  output = std::vector<uint64_t>( nwords );
+
+    return Pack( id, output.data() ), output;
+  }
+
+}}
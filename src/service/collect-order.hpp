@@ -0,0 +1,180 @@
+# if !defined( __palmira_src_service_collect_order_hpp__ )
+# define __palmira_src_service_collect_order_hpp__
+# include "doc-values.hpp"
+# include <mtc/zmap.h>
+# include <cstring>
+# include <vector>
+# include <cmath>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * SortKeys
+  *
+  * Multi-key order of the documents by the doc-values fields compiled from the
+  * search 'sort' argument:
+  *
+  *   "sort": [ { "field": "year", "order": "desc" }, { "field": "author" } ]
+  *
+  * Each field value is packed to the order-preserving uint64_t words (two words
+  * for short strings), inverted for the descending order, so the documents are
+  * compared as the arrays of integers; the documents having no value are placed
+  * after the others.  Equal keys are ordered by relevance, then by docid.
+  */
+  class SortKeys final
+  {
+    struct field
+    {
+      const DocValues::Column*  column;
+      bool                      invert;
+    };
+
+  public:
+    SortKeys( const mtc::zval&, const DocValues& );
+
+  public:
+   /*
+    * count of the key words for a document
+    */
+    auto  Width() const -> size_t {  return nwords;  }
+
+   /*
+    * GetKeys( id )
+    *
+    * Returns the packed key of the document
+    */
+    auto  GetKeys( uint32_t id ) const -> std::vector<uint64_t>;
+
+   /*
+    * Pack( id, keys )
+    *
+    * Packs the key of the document to Width() words; the candidates are packed once
+    * and compared by the keys stored then
+    */
+    void  Pack( uint32_t id, uint64_t* keys ) const
+    {
+      for ( auto& next: fields )
+        keys += GetWords( next, id, keys );
+    }
+
+   /*
+    * Compare( d1, f1, d2, f2 )
+    *
+    * Compares two documents as the DifferFn does: negative if (d1, f1) is better.
+    * The values are read from the columns, so the packed keys are preferred for the
+    * documents compared many times.
+    */
+    int   Compare( uint32_t d1, double f1, uint32_t d2, double f2 ) const
+    {
+      for ( auto& next: fields )
+      {
+        uint64_t  k1[2];
+        uint64_t  k2[2];
+        auto      nw = GetWords( next, d1, k1 );
+
+        GetWords( next, d2, k2 );
+
+        for ( size_t i = 0; i != nw; ++i )
+          if ( k1[i] != k2[i] )
+            return k1[i] < k2[i] ? -1 : 1;
+      }
+      return Relevance( d1, f1, d2, f2 );
+    }
+
+   /*
+    * Compare( k1, d1, f1, k2, d2, f2 )
+    *
+    * Compares two documents by the keys packed, e.g. the candidate to the cursor
+    */
+    int   Compare( const uint64_t* k1, uint32_t d1, double f1, const uint64_t* k2, uint32_t d2, double f2 ) const
+    {
+      for ( size_t i = 0; i != nwords; ++i )
+        if ( k1[i] != k2[i] )
+          return k1[i] < k2[i] ? -1 : 1;
+      return Relevance( d1, f1, d2, f2 );
+    }
+
+   /*
+    * Relevance( d1, f1, d2, f2 )
+    *
+    * Orders the documents having equal keys
+    */
+    static  int   Relevance( uint32_t d1, double f1, uint32_t d2, double f2 )
+    {
+      int   res = (f1 < f2) - (f1 > f2);
+      return res != 0 ? res : (d1 > d2) - (d1 < d2);
+    }
+
+  protected:
+    static  auto  GetWords( const field&, uint32_t, uint64_t* ) -> size_t;
+
+  protected:
+    std::vector<field>  fields;
+    size_t              nwords = 0;
+
+  };
+
+ /*
+  * GetWords( field, id, keys )
+  *
+  * Packs the field value to the order-preserving words; returns the count of words
+  */
+  inline  auto  SortKeys::GetWords( const field& fd, uint32_t id, uint64_t* keys ) -> size_t
+  {
+    auto  column = fd.column;
+    auto  invert = fd.invert ? ~uint64_t(0) : uint64_t(0);
+
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        {
+          auto  value = column->GetInt( id );
+
+          keys[0] = value != DocValues::Column::null_int ? (uint64_t(value) ^ (uint64_t(1) << 63)) ^ invert : ~uint64_t(0);
+          return 1;
+        }
+      case DocValues::Type::UInt:
+        {
+          auto  value = column->GetUInt( id );
+
+          keys[0] = value != DocValues::Column::null_uint ? value ^ invert : ~uint64_t(0);
+          return 1;
+        }
+      case DocValues::Type::Double:
+        {
+          auto      value = column->GetDouble( id );
+          uint64_t  dbits;
+
+          if ( std::isnan( value ) )
+            return keys[0] = ~uint64_t(0), 1;
+
+          memcpy( &dbits, &value, sizeof(dbits) );
+
+          keys[0] = ((dbits >> 63) != 0 ? ~dbits : dbits | (uint64_t(1) << 63)) ^ invert;
+          return 1;
+        }
+      case DocValues::Type::String:
+        {
+          auto  string = column->GetString( id );
+
+          if ( string.empty() )
+            return keys[0] = keys[1] = ~uint64_t(0), 2;
+
+          keys[0] = keys[1] = 0;
+
+          for ( size_t i = 0; i != string.size(); ++i )
+            keys[i / 8] |= uint64_t(uint8_t(string[i])) << (56 - (i % 8) * 8);
+
+          keys[0] ^= invert;
+          keys[1] ^= invert;
+          return 2;
+        }
+      default:
+        return 0;
+    }
+  }
+
+}}
+
+# endif   // !__palmira_src_service_collect_order_hpp__
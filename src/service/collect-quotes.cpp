@@ -34,17 +34,39 @@ namespace collect {
       abstract_data stored;
     };
 
+    enum: uint32_t
+    {
+      empty_slot = uint32_t(-1)
+    };
+
     unsigned        limit;
     unsigned        count = 0;
+    uint32_t*       hslots;
+    uint32_t        hmask;
     abstract_item   items[1];
 
   public:
-    abstracts( unsigned ulimit ): limit( ulimit ) {}
+    abstracts( unsigned ulimit, uint32_t nslots ): limit( ulimit ),
+      hslots( (uint32_t*)(items + ulimit) ),
+      hmask( nslots - 1 )
+    {
+      std::fill( hslots, hslots + nslots, uint32_t(empty_slot) );
+    }
 
   public:
     static
     auto  Create( unsigned maxcount ) -> abstracts*;
 
+  public:
+    auto  Lookup( uint32_t docid ) const -> uint32_t;
+    void  Insert( uint32_t docid, uint32_t index );
+    void  Delete( uint32_t docid );
+
+  protected:
+    auto  HashOf( uint32_t docid ) const -> uint32_t
+      {  return (docid * 0x9E3779B1U) & hmask;  }
+    auto  Locate( uint32_t docid ) const -> uint32_t;
+
   };
 
   auto  CopyAbstract( Abstract* output, const Abstract& source ) -> Abstract*
@@ -123,7 +145,8 @@ namespace collect {
 
   // Abstracts implementation
 
-  Abstracts::Abstracts( unsigned maxcount ): storage( abstracts::Create( maxcount ) )
+  Abstracts::Abstracts( unsigned maxcount ):
+    storage( maxcount != 0 ? abstracts::Create( maxcount ) : nullptr )
   {
   }
 
@@ -138,42 +161,113 @@ namespace collect {
 
   void  Abstracts::Set( uint32_t newid, const Abstract& abstr, uint32_t oldid )
   {
-    if ( storage != nullptr )
+    uint32_t  pindex;
+
+    if ( storage == nullptr )
+      throw std::logic_error( "Abstracts has no data storage" );
+
+  // check if the document is already stored
+    if ( (pindex = storage->Lookup( newid )) != abstracts::empty_slot )
+      return (void)CopyAbstract( (Abstract*)&storage->items[pindex].stored, abstr );
+
+  // check if replaces other document
+    if ( oldid != uint32_t(-1) && (pindex = storage->Lookup( oldid )) != abstracts::empty_slot )
     {
-      for ( auto p = storage->items; p != storage->items + storage->count; ++p )
-        if ( p->udocid == oldid )
-        {
-          CopyAbstract( (Abstract*)&p->stored, abstr );
-          return void(p->udocid = newid);
-        }
-      if ( storage->count < storage->limit )
-      {
-        CopyAbstract( (Abstract*)&storage->items[storage->count].stored, abstr );
-        return void(storage->items[storage->count++].udocid = newid);
-      }
-      throw std::logic_error( "Abstracts storage overflow" );
+      storage->Delete( oldid );
+    }
+      else
+    if ( storage->count < storage->limit )
+    {
+      pindex = storage->count++;
     }
-    throw std::logic_error( "Abstracts has no data storage" );
+      else
+    throw std::logic_error( "Abstracts storage overflow" );
+
+    CopyAbstract( (Abstract*)&storage->items[pindex].stored, abstr );
+      storage->items[pindex].udocid = newid;
+    storage->Insert( newid, pindex );
   }
 
   auto  Abstracts::Get( uint32_t getid ) const -> const Abstract*
   {
-    if ( storage != nullptr )
-      for ( auto p = storage->items; p != storage->items + storage->count; ++p )
-        if ( p->udocid == getid )
-          return (const Abstract*)&p->stored;
+    uint32_t  pindex;
+
+    if ( storage != nullptr && (pindex = storage->Lookup( getid )) != abstracts::empty_slot )
+      return (const Abstract*)&storage->items[pindex].stored;
     return nullptr;
   }
 
+  void  Abstracts::Clear()
+  {
+    if ( storage != nullptr )
+    {
+      std::fill( storage->hslots, storage->hslots + storage->hmask + 1, uint32_t(abstracts::empty_slot) );
+      storage->count = 0;
+    }
+  }
+
   // Abstracts::abstracts implementation
 
+ /*
+  * The open-addressed docid->item index with linear probing; the table has at least
+  * twice as many slots as the items stored, so the probe sequences are short
+  */
   auto  Abstracts::abstracts::Create( unsigned maxcount ) -> abstracts*
   {
-    auto  nalloc = sizeof(abstracts) + (maxcount - 1) * sizeof(abstracts::abstract_item);
+    auto  nslots = uint32_t(4);
+
+    while ( nslots < maxcount * 2 )
+      nslots <<= 1;
+
+    auto  nalloc = sizeof(abstracts) + (maxcount - 1) * sizeof(abstracts::abstract_item) + nslots * sizeof(uint32_t);
     auto  nitems = (nalloc + sizeof(abstracts) - 1) / sizeof(abstracts);
     auto  palloc = std::allocator<abstracts>().allocate( nitems );
 
-    return new( palloc ) abstracts( maxcount );
+    return new( palloc ) abstracts( maxcount, nslots );
+  }
+
+  auto  Abstracts::abstracts::Locate( uint32_t docid ) const -> uint32_t
+  {
+    auto  hindex = HashOf( docid );
+
+    while ( hslots[hindex] != empty_slot && items[hslots[hindex]].udocid != docid )
+      hindex = (hindex + 1) & hmask;
+
+    return hindex;
+  }
+
+  auto  Abstracts::abstracts::Lookup( uint32_t docid ) const -> uint32_t
+  {
+    return hslots[Locate( docid )];
+  }
+
+  void  Abstracts::abstracts::Insert( uint32_t docid, uint32_t pindex )
+  {
+    hslots[Locate( docid )] = pindex;
+  }
+
+ /*
+  * Deletes the document from the index with backward shift of the following
+  * elements of the probe sequence, so no tombstones are needed
+  */
+  void  Abstracts::abstracts::Delete( uint32_t docid )
+  {
+    auto  hindex = Locate( docid );
+
+    if ( hslots[hindex] == empty_slot )
+      return;
+
+    for ( auto hafter = (hindex + 1) & hmask; hslots[hafter] != empty_slot; hafter = (hafter + 1) & hmask )
+    {
+      auto  hstart = HashOf( items[hslots[hafter]].udocid );
+
+      if ( ((hafter - hstart) & hmask) >= ((hafter - hindex) & hmask) )
+      {
+        hslots[hindex] = hslots[hafter];
+        hindex = hafter;
+      }
+    }
+    hslots[hindex] = empty_slot;
   }
 
 }}
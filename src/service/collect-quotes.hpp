@@ -13,10 +13,12 @@ namespace collect {
 
   public:
     Abstracts( unsigned maxcount );
+    Abstracts( const Abstracts& ) = delete;
    ~Abstracts();
 
     void  Set( uint32_t new_id, const Abstract&, uint32_t old_id = -1 );
     auto  Get( uint32_t get_id ) const -> const Abstract*;
+    void  Clear();
   };
 
 }}
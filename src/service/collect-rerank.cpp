@@ -0,0 +1,144 @@
+# include "collect-rerank.hpp"
+# include "structo/compat.hpp"
+# include <stdexcept>
+# include <algorithm>
+# include <cmath>
+
+namespace palmira {
+namespace collect {
+
+  RerankSpec::RerankSpec( const mtc::zmap& spec, const DocValues* values )
+  {
+    int64_t window_size = default_window;
+
+    if ( spec.get( "window" ) != nullptr && (!DocValues::GetValue( *spec.get( "window" ), window_size )
+      || window_size <= 0 || window_size > max_window) )
+    {
+      throw std::invalid_argument( "'rerank' window has to be in 1..10000 @" __FILE__ ":" LINE_STRING );
+    }
+    window = uint32_t(window_size);
+
+    if ( spec.get( "proximity" ) != nullptr && (!DocValues::GetValue( *spec.get( "proximity" ), nearby ) || nearby < 0.0) )
+      throw std::invalid_argument( "'rerank' proximity has to be non-negative number @" __FILE__ ":" LINE_STRING );
+
+    if ( spec.get( "freshness" ) != nullptr )
+    {
+      auto  fresh = spec.get_zmap( "freshness" );
+
+      if ( fresh == nullptr )
+        throw std::invalid_argument( "'rerank' freshness has to be { 'field': name, 'origin': ..., 'scale': ... } @" __FILE__ ":" LINE_STRING );
+
+      recent.column = GetColumn( *fresh, values );
+
+      if ( fresh->get( "origin" ) == nullptr || !DocValues::GetValue( *fresh->get( "origin" ), recent.origin ) )
+        throw std::invalid_argument( "'rerank' freshness 'origin' has to be a number @" __FILE__ ":" LINE_STRING );
+
+      if ( fresh->get( "scale" ) == nullptr || !DocValues::GetValue( *fresh->get( "scale" ), recent.dscale ) || !(recent.dscale > 0.0) )
+        throw std::invalid_argument( "'rerank' freshness 'scale' has to be positive number @" __FILE__ ":" LINE_STRING );
+
+      recent.weight = 1.0;
+
+      if ( fresh->get( "weight" ) != nullptr && (!DocValues::GetValue( *fresh->get( "weight" ), recent.weight ) || recent.weight < 0.0) )
+        throw std::invalid_argument( "'rerank' freshness 'weight' has to be non-negative number @" __FILE__ ":" LINE_STRING );
+    }
+
+    if ( spec.get( "boost" ) != nullptr )
+    {
+      auto  boost = spec.get_zmap( "boost" );
+
+      if ( boost == nullptr )
+        throw std::invalid_argument( "'rerank' boost has to be { 'field': name, 'factor': ... } @" __FILE__ ":" LINE_STRING );
+
+      scaled.column = GetColumn( *boost, values );
+      scaled.factor = 1.0;
+
+      if ( boost->get( "factor" ) != nullptr && (!DocValues::GetValue( *boost->get( "factor" ), scaled.factor ) || scaled.factor < 0.0) )
+        throw std::invalid_argument( "'rerank' boost 'factor' has to be non-negative number @" __FILE__ ":" LINE_STRING );
+    }
+  }
+
+  auto  RerankSpec::operator()( uint32_t id, double weight, const Abstract& tuples ) const -> double
+  {
+    double  fvalue;
+
+    if ( nearby > 0.0 )
+      weight *= 1.0 + nearby * Proximity( tuples );
+
+    if ( recent.column != nullptr && GetNumber( recent.column, id, fvalue ) )
+      weight *= 1.0 + recent.weight * exp( -fabs( recent.origin - fvalue ) / recent.dscale );
+
+    if ( scaled.column != nullptr && GetNumber( scaled.column, id, fvalue ) )
+      weight *= 1.0 + scaled.factor * log1p( std::max( fvalue, 0.0 ) );
+
+    return weight;
+  }
+
+  auto  RerankSpec::GetColumn( const mtc::zmap& spec, const DocValues* values ) -> const DocValues::Column*
+  {
+    auto  fdname = spec.get_charstr( "field" );
+    auto  column = (const DocValues::Column*)nullptr;
+
+    if ( fdname == nullptr )
+      throw std::invalid_argument( "'rerank' feature 'field' has to be a string @" __FILE__ ":" LINE_STRING );
+
+    if ( values == nullptr || (column = values->GetColumn( *fdname )) == nullptr )
+      throw std::invalid_argument( "'rerank' field '" + *fdname + "' is not declared in 'doc_values' @" __FILE__ ":" LINE_STRING );
+
+    if ( column->GetType() == DocValues::Type::String )
+      throw std::invalid_argument( "'rerank' field '" + *fdname + "' has to be numeric @" __FILE__ ":" LINE_STRING );
+
+    return column;
+  }
+
+  bool  RerankSpec::GetNumber( const DocValues::Column* column, uint32_t id, double& value )
+  {
+    switch ( column->GetType() )
+    {
+      case DocValues::Type::Int:
+        {
+          auto  ivalue = column->GetInt( id );
+
+          if ( ivalue == DocValues::Column::null_int )
+            return false;
+          return value = double(ivalue), true;
+        }
+      case DocValues::Type::UInt:
+        {
+          auto  uvalue = column->GetUInt( id );
+
+          if ( uvalue == DocValues::Column::null_uint )
+            return false;
+          return value = double(uvalue), true;
+        }
+      case DocValues::Type::Double:
+        return !std::isnan( value = column->GetDouble( id ) );
+      default:
+        return false;
+    }
+  }
+
+ /*
+  * Proximity( abstract )
+  *
+  * The density of the best entry found: the count of the words matched to the
+  * count of the words the entry spans; the single word entries are not dense
+  */
+  auto  RerankSpec::Proximity( const Abstract& tuples ) -> double
+  {
+    double  dense = 0.0;
+
+    if ( tuples.dwMode != Abstract::Rich )
+      return dense;
+
+    for ( auto p = tuples.entries.pbeg; p < tuples.entries.pend; ++p )
+    {
+      auto  npos = size_t(p->spread.pend - p->spread.pbeg);
+      auto  span = size_t(p->limits.uMax - p->limits.uMin) + 1;
+
+      if ( npos > 1 && span >= npos )
+        dense = std::max( dense, double(npos) / span );
+    }
+    return dense;
+  }
+
+}}
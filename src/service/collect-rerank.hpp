@@ -0,0 +1,84 @@
+# if !defined( __palmira_src_service_collect_rerank_hpp__ )
+# define __palmira_src_service_collect_rerank_hpp__
+# include "doc-values.hpp"
+# include "structo/queries.hpp"
+# include <mtc/zmap.h>
+
+namespace palmira {
+namespace collect {
+
+  using Abstract = structo::queries::Abstract;
+
+ /*
+  * RerankSpec
+  *
+  * The second phase ranking requested by the search 'rerank' argument; it weights
+  * the 'window' best documents of the first phase only:
+  *
+  *   "rerank": {
+  *     "window": 500,
+  *     "proximity": 0.5,
+  *     "freshness": { "field": "year", "origin": 2025, "scale": 10, "weight": 0.2 },
+  *     "boost": { "field": "rating", "factor": 0.1 }
+  *   }
+  *
+  * The first phase weight is multiplied by the factors of the features requested:
+  *
+  *   proximity   1 + proximity * max( positions / span ) of the entries found;
+  *   freshness   1 + weight * exp( -|origin - value| / scale );
+  *   boost       1 + factor * log( 1 + max( value, 0 ) ).
+  *
+  * The documents having no field value get no freshness and no boost.
+  */
+  class RerankSpec final
+  {
+    struct decay
+    {
+      const DocValues::Column*  column = nullptr;
+      double                    origin = 0.0;
+      double                    dscale = 1.0;
+      double                    weight = 0.0;
+    };
+
+    struct boost
+    {
+      const DocValues::Column*  column = nullptr;
+      double                    factor = 0.0;
+    };
+
+  public:
+    enum: uint32_t
+    {
+      default_window = 500,
+      max_window = 10000
+    };
+
+  public:
+    RerankSpec( const mtc::zmap&, const DocValues* );
+
+  public:
+    auto  GetWindow() const -> uint32_t {  return window;  }
+
+   /*
+    * operator()( id, weight, abstract )
+    *
+    * Returns the second phase weight; thread-safe
+    */
+    auto  operator()( uint32_t id, double weight, const Abstract& ) const -> double;
+
+  protected:
+    static  auto  GetColumn( const mtc::zmap&, const DocValues* ) -> const DocValues::Column*;
+    static  bool  GetNumber( const DocValues::Column*, uint32_t, double& );
+    static  auto  Proximity( const Abstract& ) -> double;
+
+  protected:
+    uint32_t  window = default_window;
+    double    nearby = 0.0;
+    decay     recent;
+    boost     scaled;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_collect_rerank_hpp__
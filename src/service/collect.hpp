@@ -3,12 +3,21 @@
 # include "structo/contents.hpp"
 # include "structo/queries.hpp"
 # include "structo/compat.hpp"
-# include <mtc/threadPool.hpp>
+# include "executor.hpp"
+# include "../../ranker.hpp"
 # include <mtc/zmap.h>
+# include <string>
+# include <vector>
+# include <chrono>
 
 namespace palmira {
 namespace collect {
 
+  class Filter;
+  class SortKeys;
+  class FacetSpec;
+  class GroupSpec;
+
   using IQuery         = structo::queries::IQuery;
   using IContentsIndex = structo::IContentsIndex;
   using Abstract       = structo::queries::Abstract;
@@ -32,15 +41,41 @@ namespace collect {
     using DifferFn = std::function<int( uint32_t, double, uint32_t, double )>;
     using RankerFn = std::function<double( uint32_t, const Abstract& )>;
     using QuotesFn = std::function<mtc::array_zval( uint32_t, const Abstract& )>;
+    using RerankFn = std::function<double( uint32_t, double, const Abstract& )>;
+
+    using time_point = std::chrono::steady_clock::time_point;
+
+    enum class Mode
+    {
+      Ranked,       // top documents ranked and quoted
+      Count,        // exact count of the documents found only
+      Estimate      // count extrapolated by the sample of the docid range
+    };
 
     auto  SetFirst( uint32_t          nFirst ) -> Documents&;
     auto  SetCount( uint32_t          nCount ) -> Documents&;
     auto  SetOrder( DifferFn          fnComp ) -> Documents&;   // default by range
+    auto  SetOrder( std::shared_ptr<const SortKeys> ) -> Documents&;   // by metadata fields, then by range
     auto  SetRange( RankerFn          ranker ) -> Documents&;
-    auto  SetQuote( QuotesFn          quotes ) -> Documents&;
-    auto  SetAsync( mtc::ThreadPool*  actors ) -> Documents&;
+    auto  SetRange( mtc::api<IRanker> ranker ) -> Documents&;  // plugin scoring the blocks of documents
+    auto  SetRerank( RerankFn         rerank, uint32_t ntop = 500 ) -> Documents&;  // second phase over the top documents
+    auto  SetQuote( QuotesFn          quotes, double   tlimit = -1.0 ) -> Documents&;   // quotation time budget, s
+    auto  SetAsync( Executor*         actors, unsigned nlimit = 0 ) -> Documents&;
+    auto  SetTimer( time_point        tlimit ) -> Documents&;   // search deadline, partial results after
+    auto  SetAfter( const std::string& cursor ) -> Documents&;  // page following the cursor reported
+    auto  SetMode( Mode               dwmode ) -> Documents&;   // ranked by default
+    auto  SetCheck( std::shared_ptr<const Filter> ) -> Documents&;  // metadata filter
+    auto  SetFacet( std::shared_ptr<const FacetSpec> ) -> Documents&; // facet counters
+    auto  SetGroup( std::shared_ptr<const GroupSpec> ) -> Documents&; // field collapsing
+    auto  SetProfile( bool            report ) -> Documents&;   // phases timings and counters
 
     auto  Create() -> mtc::api<ICollector>;
+
+  public:
+    static
+    auto  MakeCursor( uint32_t, double, const std::vector<uint64_t>& = {} ) -> std::string;
+    static
+    bool  LoadCursor( const std::string&, uint32_t&, double&, std::vector<uint64_t>& );
   };
 
 }}
@@ -0,0 +1,114 @@
+# include "doc-arena.hpp"
+
+namespace palmira {
+
+  static  std::atomic_uint64_t  nDocuments( 0 );    // documents processed
+  static  std::atomic_uint64_t  nAllocated( 0 );    // heap blocks allocated above the initial blocks
+  static  std::atomic_uint64_t  nBlockGrow( 0 );    // initial blocks grown
+
+ /*
+  * DocArena::upstream
+  *
+  * Heap resource counting the memory the document takes above the initial block
+  */
+  class DocArena::upstream final: public std::pmr::memory_resource
+  {
+  public:
+    size_t  overflow = 0;
+
+  protected:
+    void* do_allocate( size_t bytes, size_t align ) override
+    {
+      ++nAllocated;
+        overflow += bytes;
+      return std::pmr::new_delete_resource()->allocate( bytes, align );
+    }
+    void  do_deallocate( void* p, size_t bytes, size_t align ) override
+    {
+      std::pmr::new_delete_resource()->deallocate( p, bytes, align );
+    }
+    bool  do_is_equal( const memory_resource& other ) const noexcept override
+    {
+      return this == &other;
+    }
+  };
+
+  // DocArena implementation
+
+  DocArena::DocArena( size_t block ):
+    backing( new upstream() ),
+    initial( new char[block] ),
+    blsize( block ),
+    memory( new std::pmr::monotonic_buffer_resource( initial.get(), blsize, backing.get() ) )
+  {
+  }
+
+  DocArena::~DocArena()
+  {
+  }
+
+  auto  DocArena::GetMetrics() -> mtc::zmap
+  {
+    return {
+      { "documents",   uint64_t(nDocuments.load()) },
+      { "allocations", uint64_t(nAllocated.load()) },
+      { "grown",       uint64_t(nBlockGrow.load()) } };
+  }
+
+  auto  DocArena::Start() -> std::pmr::memory_resource*
+  {
+    ++nDocuments;
+      backing->overflow = 0;
+    return leased = true, memory.get();
+  }
+
+ /*
+  * Reset()
+  *
+  * Releases the memory of the document keeping the initial block; if the document
+  * did not fit the initial block, grows it for the next documents
+  */
+  void  DocArena::Reset()
+  {
+    auto  newlen = blsize;
+
+    memory->release();
+      leased = false;
+
+    if ( backing->overflow == 0 || blsize >= max_block )
+      return;
+
+    while ( newlen < blsize + backing->overflow && newlen < max_block )
+      newlen *= 2;
+
+    memory.reset();
+    initial.reset( new char[newlen] );
+      blsize = newlen;
+    memory.reset( new std::pmr::monotonic_buffer_resource( initial.get(), blsize, backing.get() ) );
+
+    ++nBlockGrow;
+  }
+
+  // DocArena::Lease implementation
+
+  DocArena::Lease::Lease()
+  {
+    thread_local DocArena local;
+
+    if ( local.leased )
+    {
+      privarena = std::make_unique<DocArena>();
+      docarena = privarena.get();
+    }
+      else
+    docarena = &local;
+
+    memory = docarena->Start();
+  }
+
+  DocArena::Lease::~Lease()
+  {
+    docarena->Reset();
+  }
+
+}
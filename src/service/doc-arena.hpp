@@ -0,0 +1,83 @@
+# if !defined( __palmira_src_service_doc_arena_hpp__ )
+# define __palmira_src_service_doc_arena_hpp__
+# include <mtc/zmap.h>
+# include <memory_resource>
+# include <memory>
+# include <atomic>
+
+namespace palmira {
+
+ /*
+  * DocArena
+  *
+  * Thread-local memory for the image of the document being processed.  The
+  * arena is a monotonic buffer that is released, not freed, between documents.
+  * Its initial block grows to fit the largest document the thread has
+  * processed, so a thread that has warmed up makes no heap allocations for the
+  * document images.
+  *
+  * The memory is leased for one document:
+  *
+  *   auto  arenas = DocArena::Lease();
+  *   auto  pwBody = BaseImage<DocArena::allocator_type>( arenas.get_allocator() );
+  *
+  * The objects allocated must be destroyed before the lease ends.  A nested lease
+  * in the same thread gets its own private arena.
+  */
+  class DocArena final
+  {
+    class upstream;
+
+  public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    class Lease;
+
+    enum: size_t
+    {
+      min_block = 0x10000,
+      max_block = 0x1000000
+    };
+
+  public:
+    DocArena( size_t block = min_block );
+   ~DocArena();
+
+    static  auto  GetMetrics() -> mtc::zmap;
+
+  protected:
+    auto  Start() -> std::pmr::memory_resource*;
+    void  Reset();
+
+  protected:
+    std::unique_ptr<upstream>                 backing;
+    std::unique_ptr<char[]>                   initial;
+    size_t                                    blsize;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> memory;
+    bool                                      leased = false;
+
+  };
+
+  class DocArena::Lease
+  {
+  public:
+    Lease();
+   ~Lease();
+
+    Lease( const Lease& ) = delete;
+    Lease& operator = ( const Lease& ) = delete;
+
+  public:
+    auto  get_allocator() const -> allocator_type {  return allocator_type( memory );  }
+    auto  get_resource() const -> std::pmr::memory_resource*  {  return memory;  }
+
+  protected:
+    std::unique_ptr<DocArena> privarena;
+    DocArena*                 docarena;
+    std::pmr::memory_resource*  memory;
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_doc_arena_hpp__
@@ -0,0 +1,331 @@
+# include "doc-values.hpp"
+# include "structo/compat.hpp"
+# include <moonycode/codes.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# include <stdexcept>
+# include <algorithm>
+# include <cstring>
+# include <fcntl.h>
+# include <unistd.h>
+# include <cerrno>
+# include <cmath>
+
+namespace palmira {
+
+  // DocValues::Column file header
+
+  struct DocValues::Column::header
+  {
+    char      magic[4];
+    uint8_t   fdtype;
+    uint8_t   nwidth;
+    uint16_t  unused;
+    uint32_t  nslots;
+  };
+
+  constexpr size_t  header_size = 0x40;
+  constexpr char    header_magic[4] = { 'p', 'd', 'v', '1' };
+
+  // helper functions
+
+  static  auto  GetWidth( DocValues::Type type ) -> size_t
+  {
+    return type == DocValues::Type::String ? DocValues::short_string : sizeof(uint64_t);
+  }
+
+  static  auto  GetFdType( const std::string& name ) -> DocValues::Type
+  {
+    if ( name == "int" )    return DocValues::Type::Int;
+    if ( name == "uint" )   return DocValues::Type::UInt;
+    if ( name == "double" ) return DocValues::Type::Double;
+    if ( name == "string" ) return DocValues::Type::String;
+
+    throw std::invalid_argument( "doc_values field type has to be 'int', 'uint', 'double' or 'string' @" __FILE__ ":" LINE_STRING );
+  }
+
+  // DocValues implementation
+
+ /*
+  * GetString( value )
+  *
+  * Returns the string value as it is stored in the column: utf-8 truncated to
+  * short_string bytes not splitting the character sequence
+  */
+  auto  DocValues::GetString( const mtc::zval& value ) -> std::string
+  {
+    auto  string = std::string();
+    auto  length = size_t(0);
+
+    if ( value.get_charstr() != nullptr )
+      string = *value.get_charstr();
+    else
+    if ( value.get_widestr() != nullptr )
+      string = codepages::widetombcs( codepages::codepage_utf8, *value.get_widestr() );
+
+    if ( (length = string.length()) > short_string )
+    {
+      for ( length = short_string; length != 0 && (string[length] & 0xc0) == 0x80; )
+        --length;
+      string.resize( length );
+    }
+    return string;
+  }
+
+  DocValues::DocValues( const std::string& path, const mtc::zmap& fields, uint32_t maxdocs )
+  {
+    if ( path.empty() )
+      throw std::invalid_argument( "doc_values 'path' has to be defined @" __FILE__ ":" LINE_STRING );
+
+    if ( ::mkdir( path.c_str(), 0755 ) != 0 && errno != EEXIST )
+      throw std::runtime_error( "could not create doc_values directory '" + path + "' @" __FILE__ ":" LINE_STRING );
+
+    for ( auto& next: fields )
+    {
+      if ( !next.first.is_charstr() || next.second.get_charstr() == nullptr )
+        throw std::invalid_argument( "doc_values field type has to be string @" __FILE__ ":" LINE_STRING );
+
+      columns.emplace_back( new Column( next.first.to_charstr(), GetFdType( *next.second.get_charstr() ),
+        path + '/' + next.first.to_charstr() + ".dv", maxdocs ) );
+    }
+  }
+
+  DocValues::~DocValues()
+  {
+    Sync();
+  }
+
+  auto  DocValues::GetColumn( const std::string_view& name ) const -> const Column*
+  {
+    for ( auto& next: columns )
+      if ( next->GetName() == name )
+        return next.get();
+    return nullptr;
+  }
+
+ /*
+  * Set( id, metadata )
+  *
+  * Stores all the columns of the document; the fields not found in metadata are
+  * set to null values, so the call replaces the previous document values completely
+  */
+  void  DocValues::Set( uint32_t id, const mtc::zmap& metadata )
+  {
+    for ( auto& next: columns )
+      next->Set( id, metadata.get( next->GetName().c_str() ) );
+  }
+
+  void  DocValues::Del( uint32_t id )
+  {
+    for ( auto& next: columns )
+      next->Set( id, nullptr );
+  }
+
+  void  DocValues::Sync()
+  {
+    for ( auto& next: columns )
+      next->Sync();
+  }
+
+  // DocValues::Column implementation
+
+  DocValues::Column::Column( const std::string& name, Type type, const std::string& path, uint32_t maxdocs ):
+    fdName( name ),
+    fdType( type ),
+    nWidth( GetWidth( type ) ),
+    maxDoc( maxdocs )
+  {
+    struct stat fstats;
+    header*     phead;
+    auto        failed = [&]( const char* msg )
+      {
+        if ( mapped != nullptr )
+          ::munmap( mapped, maplen );
+        ::close( handle );
+        return std::runtime_error( std::string( msg ) + " '" + path + "' @" __FILE__ ":" LINE_STRING );
+      };
+
+    if ( (handle = ::open( path.c_str(), O_RDWR | O_CREAT, 0644 )) < 0 )
+      throw std::runtime_error( "could not open doc_values file '" + path + "' @" __FILE__ ":" LINE_STRING );
+
+    if ( ::fstat( handle, &fstats ) != 0 )
+      throw failed( "could not stat doc_values file" );
+
+  // new file gets the header only
+    if ( fstats.st_size == 0 && ::ftruncate( handle, fstats.st_size = header_size ) != 0 )
+      throw failed( "could not create doc_values file" );
+
+    if ( size_t(fstats.st_size) < header_size )
+      throw failed( "invalid doc_values file" );
+
+  // reserve the address space for all the documents
+    maplen = header_size + size_t(maxDoc) * nWidth;
+
+    if ( (mapped = (char*)::mmap( nullptr, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0 )) == MAP_FAILED )
+    {
+      mapped = nullptr;
+      throw failed( "could not map doc_values file" );
+    }
+
+    if ( (phead = (header*)mapped)->nwidth == 0 )
+    {
+      memcpy( phead->magic, header_magic, sizeof(header_magic) );
+        phead->fdtype = uint8_t(fdType);
+        phead->nwidth = uint8_t(nWidth);
+        phead->nslots = 0;
+    }
+      else
+    if ( memcmp( phead->magic, header_magic, sizeof(header_magic) ) != 0 || phead->fdtype != uint8_t(fdType) || phead->nwidth != nWidth )
+      throw failed( "doc_values field type differs from the type stored, remove the file to rebuild" );
+
+    nSlots = std::min( { phead->nslots, uint32_t((fstats.st_size - header_size) / nWidth), maxDoc } );
+  }
+
+  DocValues::Column::~Column()
+  {
+    if ( mapped != nullptr )
+      ::munmap( mapped, maplen );
+    if ( handle >= 0 )
+      ::close( handle );
+  }
+
+  bool  DocValues::Column::Has( uint32_t id ) const
+  {
+    if ( id >= Count() )
+      return false;
+
+    switch ( fdType )
+    {
+      case Type::Int:     return GetInt( id ) != null_int;
+      case Type::UInt:    return GetUInt( id ) != null_uint;
+      case Type::Double:  return !std::isnan( GetDouble( id ) );
+      case Type::String:  return Slots()[size_t(id) * nWidth] != 0;
+      default:            return false;
+    }
+  }
+
+  auto  DocValues::Column::GetDouble( uint32_t id ) const -> double
+  {
+    return id < Count() ? ((const double*)Slots())[id] : std::nan( "" );
+  }
+
+  auto  DocValues::Column::GetString( uint32_t id ) const -> std::string_view
+  {
+    if ( id < Count() )
+    {
+      auto  strptr = Slots() + size_t(id) * nWidth;
+
+      return { strptr, strnlen( strptr, nWidth ) };
+    }
+    return {};
+  }
+
+ /*
+  * Set( id, value )
+  *
+  * Stores the value converted to the column type; null or inconvertible value
+  * clears the slot
+  */
+  void  DocValues::Column::Set( uint32_t id, const mtc::zval* value )
+  {
+    if ( id >= Count() )
+    {
+      if ( value == nullptr )
+        return;
+      Grow( id );
+    }
+
+    switch ( fdType )
+    {
+      case Type::Int:
+        {
+          auto  intval = null_int;
+            ((int64_t*)Slots())[id] = value != nullptr && GetValue( *value, intval ) ? intval : null_int;
+          break;
+        }
+      case Type::UInt:
+        {
+          auto  intval = null_uint;
+            ((uint64_t*)Slots())[id] = value != nullptr && GetValue( *value, intval ) ? intval : null_uint;
+          break;
+        }
+      case Type::Double:
+        {
+          auto  dblval = std::nan( "" );
+            ((double*)Slots())[id] = value != nullptr && GetValue( *value, dblval ) ? dblval : std::nan( "" );
+          break;
+        }
+      case Type::String:
+        {
+          auto  strptr = Slots() + size_t(id) * nWidth;
+          auto  string = value != nullptr ? DocValues::GetString( *value ) : std::string();
+
+          memset( strptr, 0, nWidth );
+          memcpy( strptr, string.data(), string.length() );
+          break;
+        }
+    }
+  }
+
+  void  DocValues::Column::Sync()
+  {
+    if ( mapped != nullptr )
+    {
+      ((header*)mapped)->nslots = Count();
+      ::msync( mapped, header_size + size_t(Count()) * nWidth, MS_ASYNC );
+    }
+  }
+
+  auto  DocValues::Column::Slots() const -> const char*
+  {
+    return mapped + header_size;
+  }
+
+  auto  DocValues::Column::Slots() -> char*
+  {
+    return mapped + header_size;
+  }
+
+  void  DocValues::Column::Clear( uint32_t from, uint32_t to )
+  {
+    switch ( fdType )
+    {
+      case Type::Int:
+        std::fill( (int64_t*)Slots() + from, (int64_t*)Slots() + to, null_int );
+        break;
+      case Type::UInt:
+        std::fill( (uint64_t*)Slots() + from, (uint64_t*)Slots() + to, null_uint );
+        break;
+      case Type::Double:
+        std::fill( (double*)Slots() + from, (double*)Slots() + to, std::nan( "" ) );
+        break;
+      case Type::String:
+        memset( Slots() + size_t(from) * nWidth, 0, size_t(to - from) * nWidth );
+        break;
+    }
+  }
+
+ /*
+  * Grow( id )
+  *
+  * Extends the file to keep the slot passed; the mapping is never moved, so the
+  * new slots become visible to readers after initialization only
+  */
+  void  DocValues::Column::Grow( uint32_t id )
+  {
+    auto  nCount = Count();
+    auto  nAlloc = uint32_t(std::min( std::max( { size_t(id) + 1, size_t(nCount) * 2, size_t(0x1000) } ), size_t(maxDoc) ));
+
+    if ( id >= maxDoc )
+      throw std::invalid_argument( "doc_values 'max_docs' limit exceeded @" __FILE__ ":" LINE_STRING );
+
+    if ( ::ftruncate( handle, header_size + size_t(nAlloc) * nWidth ) != 0 )
+      throw std::runtime_error( "could not extend doc_values file @" __FILE__ ":" LINE_STRING );
+
+    Clear( nCount, nAlloc );
+
+    ((header*)mapped)->nslots = nAlloc;
+      nSlots.store( nAlloc, std::memory_order_release );
+  }
+
+}
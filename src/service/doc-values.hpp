@@ -0,0 +1,153 @@
+# if !defined( __palmira_src_service_doc_values_hpp__ )
+# define __palmira_src_service_doc_values_hpp__
+# include <mtc/zmap.h>
+# include <string_view>
+# include <cstdint>
+# include <atomic>
+# include <memory>
+# include <string>
+# include <vector>
+
+namespace palmira {
+
+ /*
+  * DocValues
+  *
+  * Columnar side-store of the selected metadata fields indexed by the entity
+  * index, i.e. by the docid the queries return.
+  *
+  * Each field is kept in it's own memory-mapped file of fixed-width slots, so the
+  * collectors read the values by docid with a single load and never deserialize
+  * the entity extras.  Values missing in the document metadata are stored as the
+  * type-specific 'null' values and are reported by Has() as absent.
+  *
+  * The columns are modified by the single writer; readers never lock, as the whole
+  * range of max_docs slots is mapped once and the slots are published by the count
+  * of slots available.
+  */
+  class DocValues final
+  {
+  public:
+    enum class Type: uint8_t
+    {
+      Int = 1,        // int64_t
+      UInt = 2,       // uint64_t
+      Double = 3,     // double
+      String = 4      // short utf-8 string, truncated to short_string bytes
+    };
+
+    enum: size_t
+    {
+      short_string = 16
+    };
+
+    class Column;
+
+  public:
+   /*
+    * DocValues( path, fields, maxdocs )
+    *
+    * path    - directory to keep the column files in;
+    * fields  - { "name": "int" | "uint" | "double" | "string", ... };
+    * maxdocs - the limit of the entity index, defines the address space reserved.
+    */
+    DocValues( const std::string& path, const mtc::zmap& fields, uint32_t maxdocs );
+   ~DocValues();
+
+  public:
+    template <class T>
+    static  bool  GetValue( const mtc::zval&, T& );
+    static  auto  GetString( const mtc::zval& ) -> std::string;
+
+  public:
+    auto  GetColumn( const std::string_view& ) const -> const Column*;
+    auto  GetColumns() const -> const std::vector<std::unique_ptr<Column>>& {  return columns;  }
+
+    void  Set( uint32_t id, const mtc::zmap& metadata );
+    void  Del( uint32_t id );
+    void  Sync();
+
+  protected:
+    std::vector<std::unique_ptr<Column>>  columns;
+
+  };
+
+ /*
+  * Numeric metadata value conversion; returns false for non-numeric values
+  */
+  template <class T>
+  bool  DocValues::GetValue( const mtc::zval& val, T& out )
+  {
+    switch ( val.get_type() )
+    {
+      case mtc::zval::z_char:   return out = T(*val.get_char()), true;
+      case mtc::zval::z_byte:   return out = T(*val.get_byte()), true;
+      case mtc::zval::z_int16:  return out = T(*val.get_int16()), true;
+      case mtc::zval::z_word16: return out = T(*val.get_word16()), true;
+      case mtc::zval::z_int32:  return out = T(*val.get_int32()), true;
+      case mtc::zval::z_word32: return out = T(*val.get_word32()), true;
+      case mtc::zval::z_int64:  return out = T(*val.get_int64()), true;
+      case mtc::zval::z_word64: return out = T(*val.get_word64()), true;
+      case mtc::zval::z_float:  return out = T(*val.get_float()), true;
+      case mtc::zval::z_double: return out = T(*val.get_double()), true;
+      case mtc::zval::z_bool:   return out = T(*val.get_bool() ? 1 : 0), true;
+      default:                  return false;
+    }
+  }
+
+ /*
+  * DocValues::Column
+  *
+  * One field file: the header followed by the fixed-width slots.
+  */
+  class DocValues::Column final
+  {
+    struct header;
+
+  public:
+    Column( const std::string& name, Type, const std::string& path, uint32_t maxdocs );
+   ~Column();
+
+  public:
+    auto  GetName() const -> const std::string& {  return fdName;  }
+    auto  GetType() const -> Type               {  return fdType;  }
+
+    bool  Has( uint32_t id ) const;
+
+    auto  GetInt( uint32_t id ) const -> int64_t
+      {  return id < Count() ? ((const int64_t*)Slots())[id] : null_int;  }
+    auto  GetUInt( uint32_t id ) const -> uint64_t
+      {  return id < Count() ? ((const uint64_t*)Slots())[id] : null_uint;  }
+    auto  GetDouble( uint32_t id ) const -> double;
+    auto  GetString( uint32_t id ) const -> std::string_view;
+
+    void  Set( uint32_t id, const mtc::zval* );
+    void  Sync();
+
+  public:
+    static constexpr int64_t  null_int = INT64_MIN;
+    static constexpr uint64_t null_uint = UINT64_MAX;
+
+  protected:
+    auto  Count() const -> uint32_t {  return nSlots.load( std::memory_order_acquire );  }
+    auto  Slots() const -> const char*;
+    auto  Slots() -> char*;
+    void  Clear( uint32_t from, uint32_t to );
+    void  Grow( uint32_t id );
+
+  protected:
+    const std::string     fdName;
+    const Type            fdType;
+    const size_t          nWidth;
+    const uint32_t        maxDoc;
+
+    int                   handle = -1;
+    char*                 mapped = nullptr;
+    size_t                maplen = 0;
+    std::atomic_uint32_t  nSlots = 0;
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_doc_values_hpp__
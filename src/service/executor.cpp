@@ -0,0 +1,206 @@
+# include "executor.hpp"
+# include <mtc/recursive_shared_mutex.hpp>
+# include <algorithm>
+# include <utility>
+
+namespace palmira {
+
+  // Executor implementation
+
+  Executor::Executor( unsigned nthreads, unsigned nlimit )
+  {
+    if ( nthreads == 0 && (nthreads = std::thread::hardware_concurrency()) == 0 )
+      nthreads = 1;
+
+    maxTasks = nlimit != 0 ? std::min( nlimit, nthreads ) : nthreads;
+
+    for ( threads.reserve( nthreads ); threads.size() != nthreads; )
+      threads.emplace_back( &Executor::Execute, this );
+  }
+
+  Executor::~Executor()
+  {
+    mtc::interlocked( mtc::make_unique_lock( mxLock ), [this]()
+      {  finish = true;  } );
+
+    cvTask.notify_all();
+
+    for ( auto& next: threads )
+      next.join();
+  }
+
+  auto  Executor::GetMetrics() const -> mtc::zmap
+  {
+    auto  exlock = mtc::make_unique_lock( mxLock );
+
+    return {
+      { "threads",  uint32_t(threads.size()) },
+      { "active",   nActive },
+      { "queued",   nQueued },
+      { "peak",     maxQueue },
+      { "executed", nTotals } };
+  }
+
+ /*
+  * Worker thread loop: get the next runnable group from the ready queue, pick one
+  * task of the group and execute it out of lock
+  */
+  void  Executor::Execute()
+  {
+    auto  exlock = mtc::make_unique_lock( mxLock );
+
+    for ( ; ; )
+    {
+      Tasks*        pgroup;
+      Tasks::TaskFn runfun;
+
+      cvTask.wait( exlock, [this](){  return finish || !ready.empty();  } );
+
+      if ( ready.empty() )
+        return;
+
+      (pgroup = ready.front())->inQueue = false;
+        ready.pop_front();
+
+    // the group may be drained by it's own waiting thread
+      if ( !pgroup->Runnable() )
+        continue;
+
+      runfun = std::move( pgroup->pending.front() );
+        pgroup->pending.pop_front();
+        ++pgroup->running;
+
+    // the group keeps runnable, so let the idle workers take the next tasks
+      if ( pgroup->Runnable() )
+        ready.push_back( pgroup ), pgroup->inQueue = true, cvTask.notify_one();
+
+      --nQueued;
+      ++nActive;
+
+      exlock.unlock();
+        pgroup->Execute( runfun );
+      exlock.lock();
+
+      --nActive;
+      ++nTotals;
+
+    // wake the waiting thread when the group is done or is below it's limit again
+      if ( --pgroup->running == 0 && pgroup->pending.empty() )
+        cvDone.notify_all();
+      else
+      if ( pgroup->Runnable() )
+      {
+        cvDone.notify_all();
+
+        if ( !pgroup->inQueue )
+          ready.push_back( pgroup ), pgroup->inQueue = true, cvTask.notify_one();
+      }
+    }
+  }
+
+  // Executor::Tasks implementation
+
+  Executor::Tasks::Tasks( Executor* actors, unsigned limit ): executor( actors )
+  {
+    nlimit = executor == nullptr ? 1 :
+      limit != 0 ? std::min( limit, executor->GetLimit() ) : executor->GetLimit();
+  }
+
+  Executor::Tasks::~Tasks()
+  {
+    try
+    {  Wait();  }
+    catch ( ... )
+    {}
+  }
+
+  void  Executor::Tasks::Insert( TaskFn task )
+  {
+    if ( executor != nullptr )
+    {
+      auto  exlock = mtc::make_unique_lock( executor->mxLock );
+
+      pending.push_back( std::move( task ) );
+
+      executor->maxQueue = std::max( executor->maxQueue, ++executor->nQueued );
+
+      if ( Runnable() && !inQueue )
+      {
+        executor->ready.push_back( this ), inQueue = true;
+        executor->cvTask.notify_one();
+      }
+    }
+      else
+    pending.push_back( std::move( task ) );
+  }
+
+ /*
+  * Wait()
+  *
+  * Executes the pending tasks of the group in the calling thread and waits for
+  * the tasks already running in the pool.  The calling thread is one of the group
+  * tasks running, so the group limit holds for it too.  Rethrows the first exception
+  * caught.
+  */
+  void  Executor::Tasks::Wait()
+  {
+    if ( executor != nullptr )
+    {
+      auto  exlock = mtc::make_unique_lock( executor->mxLock );
+
+      for ( ; ; )
+      {
+        if ( Runnable() )
+        {
+          auto  runfun = std::move( pending.front() );
+            pending.pop_front();
+            ++running;
+
+          --executor->nQueued;
+
+          exlock.unlock();
+            Execute( runfun );
+          exlock.lock();
+
+          --running;
+        }
+          else
+        if ( running != 0 ) executor->cvDone.wait( exlock );
+          else break;
+      }
+
+    // the drained group may still stay in the ready queue
+      if ( inQueue )
+      {
+        executor->ready.erase( std::find( executor->ready.begin(), executor->ready.end(), this ) );
+        inQueue = false;
+      }
+    }
+      else
+    for ( ; !pending.empty(); pending.pop_front() )
+      Execute( pending.front() );
+
+    if ( failure != nullptr )
+      std::rethrow_exception( std::exchange( failure, nullptr ) );
+  }
+
+  void  Executor::Tasks::Execute( TaskFn& task )
+  {
+    try
+    {
+      task();
+    }
+    catch ( ... )
+    {
+      if ( executor != nullptr )
+      {
+        mtc::interlocked( mtc::make_unique_lock( executor->mxLock ), [this]()
+          {  if ( failure == nullptr ) failure = std::current_exception();  } );
+      }
+        else
+      if ( failure == nullptr )
+        failure = std::current_exception();
+    }
+  }
+
+}
@@ -0,0 +1,104 @@
+# if !defined( __palmira_src_service_executor_hpp__ )
+# define __palmira_src_service_executor_hpp__
+# include <mtc/zmap.h>
+# include <condition_variable>
+# include <functional>
+# include <exception>
+# include <thread>
+# include <vector>
+# include <deque>
+# include <mutex>
+
+namespace palmira {
+
+ /*
+  * Executor
+  *
+  * Process-wide pool of worker threads owned by the service and shared by all
+  * the requests.
+  *
+  * Tasks are never posted to the pool directly: each request creates its own
+  * Executor::Tasks group limited by the count of simultaneously running tasks
+  * and waits for the group to finish.  The waiting thread executes the pending
+  * tasks of its group itself, so nested groups never lock the pool up.
+  */
+  class Executor final
+  {
+  public:
+    class Tasks;
+
+   /*
+    * Executor( nthreads, nlimit )
+    *
+    * nthreads  - count of worker threads, 0 means hardware concurrency;
+    * nlimit    - default per-group parallelism limit, 0 means nthreads.
+    */
+    Executor( unsigned nthreads = 0, unsigned nlimit = 0 );
+   ~Executor();
+
+  public:
+    auto  GetThreads() const -> unsigned  {  return unsigned(threads.size());  }
+    auto  GetLimit() const -> unsigned    {  return maxTasks;  }
+    auto  GetMetrics() const -> mtc::zmap;
+
+  protected:
+    void  Execute();
+
+  protected:
+    std::vector<std::thread>  threads;
+    unsigned                  maxTasks;
+
+    mutable std::mutex        mxLock;
+    std::condition_variable   cvTask;
+    std::condition_variable   cvDone;
+    std::deque<Tasks*>        ready;
+    bool                      finish = false;
+
+  // queue metrics
+    uint32_t                  nQueued = 0;
+    uint32_t                  maxQueue = 0;
+    uint32_t                  nActive = 0;
+    uint64_t                  nTotals = 0;
+
+  };
+
+ /*
+  * Executor::Tasks
+  *
+  * The group of tasks of one request.  If created for a null executor, all the
+  * tasks are executed sequentially by Wait() in the calling thread.
+  */
+  class Executor::Tasks
+  {
+    friend class Executor;
+
+    using TaskFn = std::function<void()>;
+
+  public:
+    Tasks( Executor*, unsigned nlimit = 0 );
+   ~Tasks();
+
+  public:
+    void  Insert( TaskFn );
+    void  Wait();
+
+    auto  GetLimit() const -> unsigned  {  return nlimit;  }
+
+  protected:
+    bool  Runnable() const  {  return !pending.empty() && running < nlimit;  }
+    void  Execute( TaskFn& );
+
+  protected:
+    Executor*           executor;
+    unsigned            nlimit;
+
+    std::deque<TaskFn>  pending;
+    unsigned            running = 0;
+    bool                inQueue = false;
+    std::exception_ptr  failure;
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_executor_hpp__
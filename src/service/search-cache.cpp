@@ -0,0 +1,135 @@
+# include "search-cache.hpp"
+# include <mtc/recursive_shared_mutex.hpp>
+
+namespace palmira {
+
+ /*
+  * The order arguments not affecting the results found
+  */
+  static const char* const notKeyOrder[] = {
+    "threads",
+    "quote_timeout",
+    "profile" };
+
+  SearchCache::SearchCache( size_t maxmem, size_t maxcnt ):
+    maxMemory( maxmem ),
+    maxCount( maxcnt )
+  {
+  }
+
+ /*
+  * MakeKey( search )
+  *
+  * Serializes the query, the terms, the filter, the facets and the result-affecting order arguments with
+  * the defaults applied; zmap keys are ordered, so equal arguments produce equal keys
+  */
+  auto  SearchCache::MakeKey( const SearchArgs& search ) -> std::string
+  {
+    auto  ordkey = search.order.copy();
+    auto  keymap = mtc::zmap();
+    auto  serial = std::string();
+
+    for ( auto key: notKeyOrder )
+      ordkey.erase( key );
+
+    ordkey["first"] = search.order.get_int32( "first", 1 );
+    ordkey["count"] = search.order.get_int32( "count", 10 );
+
+    keymap["query"] = search.query;
+    keymap["terms"] = search.terms;
+    keymap["order"] = ordkey;
+
+    if ( !search.filter.empty() )
+      keymap["filter"] = search.filter;
+    if ( !search.facets.empty() )
+      keymap["facets"] = search.facets;
+
+    serial.resize( keymap.GetBufLen() );
+      keymap.Serialize( (char*)serial.data() );
+
+    return serial;
+  }
+
+  bool  SearchCache::Get( const std::string& key, uint64_t generation, mtc::zmap& report )
+  {
+    auto  exlock = mtc::make_unique_lock( mxLock );
+    auto  ptrent = indexMap.end();
+
+    if ( generation != cacheGen )
+    {
+    // the search was started on an outdated index, the newer reports are kept
+      if ( generation < cacheGen )
+        return ++nMiss, false;
+      Reset( generation );
+    }
+
+    if ( (ptrent = indexMap.find( key )) == indexMap.end() )
+      return ++nMiss, false;
+
+    entries.splice( entries.begin(), entries, ptrent->second );
+      report = ptrent->second->report.copy();
+
+    return ++nHits, true;
+  }
+
+  void  SearchCache::Put( const std::string& key, uint64_t generation, const mtc::zmap& report )
+  {
+    auto  exlock = mtc::make_unique_lock( mxLock );
+    auto  length = key.size() * 2 + report.GetBufLen() + sizeof(entry);
+    auto  ptrent = indexMap.end();
+
+    if ( generation != cacheGen )
+    {
+    // the report was built on an outdated index
+      if ( generation < cacheGen )
+        return;
+      Reset( generation );
+    }
+
+    if ( length > maxMemory )
+      return;
+
+    if ( (ptrent = indexMap.find( key )) != indexMap.end() )
+    {
+      memUsage -= ptrent->second->length;
+      entries.erase( ptrent->second );
+      indexMap.erase( ptrent );
+    }
+
+    entries.push_front( { key, report.copy(), length } );
+      indexMap.emplace( key, entries.begin() );
+    memUsage += length;
+
+    Evict();
+  }
+
+  auto  SearchCache::GetMetrics() const -> mtc::zmap
+  {
+    auto  exlock = mtc::make_unique_lock( mxLock );
+
+    return {
+      { "hits",   nHits },
+      { "misses", nMiss },
+      { "items",  uint32_t(entries.size()) },
+      { "memory", uint64_t(memUsage) } };
+  }
+
+  void  SearchCache::Reset( uint64_t generation )
+  {
+    entries.clear();
+    indexMap.clear();
+    memUsage = 0;
+    cacheGen = generation;
+  }
+
+  void  SearchCache::Evict()
+  {
+    while ( !entries.empty() && (memUsage > maxMemory || (maxCount != 0 && entries.size() > maxCount)) )
+    {
+      memUsage -= entries.back().length;
+      indexMap.erase( entries.back().key );
+      entries.pop_back();
+    }
+  }
+
+}
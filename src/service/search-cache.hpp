@@ -0,0 +1,72 @@
+# if !defined( __palmira_src_service_search_cache_hpp__ )
+# define __palmira_src_service_search_cache_hpp__
+# include "../../service.hpp"
+# include <mtc/zmap.h>
+# include <unordered_map>
+# include <string>
+# include <mutex>
+# include <list>
+
+namespace palmira {
+
+ /*
+  * SearchCache
+  *
+  * LRU cache of the search reports keyed by normalized search arguments.
+  *
+  * Each report is stored with the index generation it was built on; the service bumps
+  * the generation on every index modification, and the reports of older generations
+  * are never returned.
+  */
+  class SearchCache final
+  {
+    struct  entry
+    {
+      std::string key;
+      mtc::zmap   report;
+      size_t      length;
+    };
+
+    using entry_list = std::list<entry>;
+
+  public:
+   /*
+    * SearchCache( maxmem, maxcnt )
+    *
+    * maxmem  - memory limit for the keys and reports stored, bytes;
+    * maxcnt  - reports count limit, 0 means unlimited.
+    */
+    SearchCache( size_t maxmem, size_t maxcnt = 0 );
+
+  public:
+    static
+    auto  MakeKey( const SearchArgs& ) -> std::string;
+
+    bool  Get( const std::string&, uint64_t generation, mtc::zmap& );
+    void  Put( const std::string&, uint64_t generation, const mtc::zmap& );
+
+    auto  GetMetrics() const -> mtc::zmap;
+
+  protected:
+    void  Reset( uint64_t generation );
+    void  Evict();
+
+  protected:
+    const size_t          maxMemory;
+    const size_t          maxCount;
+
+    mutable std::mutex    mxLock;
+    entry_list            entries;    // most recently used first
+    std::unordered_map<std::string, entry_list::iterator>
+                          indexMap;
+    uint64_t              cacheGen = 0;
+    size_t                memUsage = 0;
+
+    uint64_t              nHits = 0;
+    uint64_t              nMiss = 0;
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_search_cache_hpp__
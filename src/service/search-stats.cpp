@@ -0,0 +1,74 @@
+# include "search-stats.hpp"
+
+namespace palmira {
+
+  static const char* const phaseNames[] = {
+    "build",
+    "search",
+    "merge",
+    "rerank",
+    "quotes",
+    "fetch",
+    "total" };
+
+  void  SearchStats::Add( Phase phase, uint64_t us )
+  {
+    auto& series = phases[phase];
+    auto  bucket = 0U;
+    auto  maxval = series.maxval.load();
+
+  // bucket n counts the durations in [2^(n-1), 2^n) microseconds
+    for ( auto value = us; value != 0 && bucket != nbuckets - 1; value >>= 1 )
+      ++bucket;
+
+    ++series.counts[bucket];
+    series.totals += us;
+
+    while ( maxval < us && !series.maxval.compare_exchange_weak( maxval, us ) )
+      (void)NULL;
+  }
+
+ /*
+  * GetMetrics()
+  *
+  * Reports the count, the mean, the percentiles and the maximum for each phase:
+  *   "search": { "count": ..., "mean_us": ..., "p50_us": ..., "p90_us": ..., "p99_us": ..., "max_us": ... }
+  */
+  auto  SearchStats::GetMetrics() const -> mtc::zmap
+  {
+    auto  output = mtc::zmap();
+
+    for ( unsigned phase = 0; phase != nPhases; ++phase )
+    {
+      auto&     series = phases[phase];
+      uint64_t  counts[nbuckets];
+      uint64_t  ntotal = 0;
+      auto      bounds = [&]( double share ) -> uint64_t
+        {
+          auto  border = uint64_t(share * ntotal + 0.5);
+          auto  nfound = uint64_t(0);
+
+          for ( unsigned i = 0; i != nbuckets; ++i )
+            if ( (nfound += counts[i]) >= border && nfound != 0 )
+              return i != 0 ? uint64_t(1) << i : 0;
+          return uint64_t(1) << (nbuckets - 1);
+        };
+
+      for ( unsigned i = 0; i != nbuckets; ++i )
+        ntotal += (counts[i] = series.counts[i].load());
+
+      if ( ntotal == 0 )
+        continue;
+
+      output[phaseNames[phase]] = mtc::zmap{
+        { "count",    ntotal },
+        { "mean_us",  series.totals.load() / ntotal },
+        { "p50_us",   bounds( 0.50 ) },
+        { "p90_us",   bounds( 0.90 ) },
+        { "p99_us",   bounds( 0.99 ) },
+        { "max_us",   series.maxval.load() } };
+    }
+    return output;
+  }
+
+}
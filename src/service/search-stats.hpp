@@ -0,0 +1,54 @@
+# if !defined( __palmira_src_service_search_stats_hpp__ )
+# define __palmira_src_service_search_stats_hpp__
+# include <mtc/zmap.h>
+# include <cstdint>
+# include <atomic>
+
+namespace palmira {
+
+ /*
+  * SearchStats
+  *
+  * Server-wide latency histograms of the search phases fed by the profiled searches.
+  *
+  * Each histogram counts the durations by log2 microsecond buckets, so the values
+  * are added without locks, and the percentiles are reported as the upper bounds
+  * of the buckets.
+  */
+  class SearchStats final
+  {
+    enum: unsigned {  nbuckets = 40  };
+
+    struct histogram
+    {
+      std::atomic_uint64_t  counts[nbuckets] = {};
+      std::atomic_uint64_t  totals = {};
+      std::atomic_uint64_t  maxval = {};
+    };
+
+  public:
+    enum Phase: unsigned
+    {
+      Build,      // query building
+      Search,     // postings traversal and ranking
+      Merge,      // merge of the partial results
+      Rerank,     // second phase ranking of the best documents
+      Quotes,     // abstracts of the page documents
+      Fetch,      // entities fetch and quotation
+      Total,
+      nPhases
+    };
+
+  public:
+    void  Add( Phase, uint64_t us );
+
+    auto  GetMetrics() const -> mtc::zmap;
+
+  protected:
+    histogram   phases[nPhases];
+
+  };
+
+}
+
+# endif   // !__palmira_src_service_search_stats_hpp__
@@ -1,4 +1,8 @@
 # include "../../service/structo-search.hpp"
+# include "executor.hpp"
+# include "search-cache.hpp"
+# include "doc-values.hpp"
+# include "../../plugins.hpp"
 # include <structo/context/lemmatizer.hpp>
 #include <structo/context/x-contents.hpp>
 # include <structo/indexer/layered-contents.hpp>
@@ -37,6 +41,50 @@ namespace palmira
     return processor;
   }
 
+ /*
+  * LoadRankers( config )
+  *
+  * Loads the ranking plugins selected by the search 'ranker' argument:
+  *   "rankers": [
+  *     { "name": "bm25f", "module": "./libranker-bm25f.so", "config": "bm25f.json" }
+  *   ]
+  */
+  auto  LoadRankers( const mtc::config& config ) -> Rankers
+  {
+    auto  rankers = Rankers();
+    auto  plugins = config.to_zmap().get( "rankers" );
+
+    if ( plugins == nullptr )
+      return rankers;
+
+    if ( plugins->get_array_zmap() == nullptr )
+      throw std::invalid_argument( "'rankers' has to be array of structures { 'name': string, 'module': path, 'config': path }" );
+
+    for ( auto& next: *plugins->get_array_zmap() )
+    {
+      auto      section = config.get_section( next );
+      auto      rk_name = section.get_charstr( "name" );
+      auto      as_path = section.get_path( "module" );
+      auto      rk_conf = section.get_path( "config" );
+      IRanker*  pranker = nullptr;
+      int       nerror;
+
+      if ( rk_name == "" )
+        throw std::invalid_argument( "ranker 'name' must be defined" );
+      if ( as_path == "" )
+        throw std::invalid_argument( "ranker 'module' must point to existing shared library" );
+      if ( rankers.find( rk_name ) != rankers.end() )
+        throw std::invalid_argument( mtc::strprintf( "ranker '%s' is declared twice", rk_name.c_str() ) );
+
+      if ( (nerror = LoadPlugin<CreateRankerFn>( as_path, "CreateRanker", &pranker, rk_conf.c_str() )) != 0 || pranker == nullptr )
+        throw std::invalid_argument( mtc::strprintf( "failed to create ranker '%s', error %d", rk_name.c_str(), nerror ) );
+
+      rankers.emplace( rk_name, pranker );
+        pranker->Detach();
+    }
+    return rankers;
+  }
+
   auto  OpenStorage( const mtc::config& config ) -> mtc::api<structo::IStorage>
   {
     auto  ixpath = config.get_path( "generic_name" );
@@ -80,6 +128,135 @@ namespace palmira
     return context::LoadFields( config.to_zmap(), "fields" );
   }
 
+ /*
+  * CreateExecutor( config )
+  *
+  * Creates the search threads pool shared by all the requests of the service:
+  *   "executor": {
+  *     "threads": 0,         // count of worker threads, 0 - hardware concurrency
+  *     "query_threads": 0    // parallel sub-queries limit per request, 0 - all the threads
+  *   }
+  */
+  auto  CreateExecutor( const mtc::config& config ) -> std::shared_ptr<Executor>
+  {
+    auto  nthreads = config.get_int32( "threads", 0 );
+    auto  nlimit = config.get_int32( "query_threads", 0 );
+
+    if ( nthreads < 0 )
+      throw std::invalid_argument( "executor 'threads' has to be non-negative integer" );
+    if ( nlimit < 0 )
+      throw std::invalid_argument( "executor 'query_threads' has to be non-negative integer" );
+
+    return std::make_shared<Executor>( unsigned(nthreads), unsigned(nlimit) );
+  }
+
+ /*
+  * CreateRpCache( config )
+  *
+  * Creates optional search results cache:
+  *   "cache": {
+  *     "memory_mb": 64,      // memory limit for the reports cached, megabytes
+  *     "max_items": 0        // reports count limit, 0 - unlimited
+  *   }
+  */
+  auto  CreateRpCache( const mtc::config& config ) -> std::shared_ptr<SearchCache>
+  {
+    if ( config.empty() )
+      return nullptr;
+
+    auto  memory = config.get_int32( "memory_mb", 64 );
+    auto  nitems = config.get_int32( "max_items", 0 );
+
+    if ( memory <= 0 )
+      throw std::invalid_argument( "cache 'memory_mb' has to be positive integer" );
+    if ( nitems < 0 )
+      throw std::invalid_argument( "cache 'max_items' has to be non-negative integer" );
+
+    return std::make_shared<SearchCache>( size_t(memory) * 1024 * 1024, size_t(nitems) );
+  }
+
+ /*
+  * CreateDocValues( config )
+  *
+  * Creates optional columnar store of the metadata fields used to sort and filter:
+  *   "doc_values": {
+  *     "path": "/var/palmira/doc-values",  // directory for the column files
+  *     "max_docs": 16777216,               // entity index limit
+  *     "fields": {                         // field types: int, uint, double, string
+  *       "year": "int",
+  *       "author": "string"
+  *     }
+  *   }
+  */
+  auto  CreateDocValues( const mtc::config& config ) -> std::shared_ptr<DocValues>
+  {
+    if ( config.empty() )
+      return nullptr;
+
+    auto  dvpath = config.get_path( "path" );
+    auto  maxdoc = config.get_int32( "max_docs", 0x1000000 );
+    auto  fields = config.to_zmap().get_zmap( "fields" );
+
+    if ( dvpath == "" )
+      throw std::invalid_argument( "doc_values 'path' has to be defined" );
+    if ( maxdoc <= 0 )
+      throw std::invalid_argument( "doc_values 'max_docs' has to be positive integer" );
+    if ( fields == nullptr )
+      throw std::invalid_argument( "doc_values 'fields' has to be structure { 'name': 'int' | 'uint' | 'double' | 'string' }" );
+
+    return std::make_shared<DocValues>( dvpath, *fields, uint32_t(maxdoc) );
+  }
+
+ /*
+  * LoadCompression( config )
+  *
+  * Selects the quotation images codec:
+  *   "compression": {
+  *     "codec": "zstd",      // 'none', 'zlib' (default), 'lz4' or 'zstd'
+  *     "level": 0,           // compression level, 0 - the codec default
+  *     "dictionary": {       // zstd only, optional
+  *       "samples": 1000,    // images sampled to train the dictionary
+  *       "size": 65536       // dictionary size, bytes
+  *     }
+  *   }
+  */
+  auto  LoadCompression( const mtc::config& config ) -> Compression
+  {
+    auto  settings = Compression();
+
+    if ( config.empty() )
+      return settings;
+
+    auto  dicts = config.get_section( "dictionary" );
+    auto  codec = config.get_charstr( "codec" );
+
+    if ( codec == "" )
+      codec = settings.codec;
+
+    if ( codec != "none" && codec != "zlib" && codec != "lz4" && codec != "zstd" )
+      throw std::invalid_argument( "compression 'codec' has to be one of 'none', 'zlib', 'lz4' or 'zstd'" );
+
+    settings.codec = codec;
+    settings.level = config.get_int32( "level", 0 );
+
+    if ( !dicts.empty() )
+    {
+      auto  nsamples = dicts.get_int32( "samples", 1000 );
+      auto  dictsize = dicts.get_int32( "size", 0x10000 );
+
+      if ( codec != "zstd" )
+        throw std::invalid_argument( "compression 'dictionary' requires 'zstd' codec" );
+      if ( nsamples <= 0 )
+        throw std::invalid_argument( "compression dictionary 'samples' has to be positive integer" );
+      if ( dictsize < 0x100 )
+        throw std::invalid_argument( "compression dictionary 'size' has to be 256 bytes at least" );
+
+      settings.samples = size_t(nsamples);
+      settings.dictlen = size_t(dictsize);
+    }
+    return settings;
+  }
+
   auto  CreateStructo( const mtc::config& config ) -> mtc::api<IService>
   {
     auto  create = StructoService();
@@ -89,6 +266,11 @@ namespace palmira
       .Set( OpenContentsIndex( config.get_section( "index" ) ) )
       .Set( GetMakeContents( config ) )
       .Set( LoadIndexFields( config ) )
+      .Set( CreateExecutor( config.get_section( "executor" ) ) )
+      .Set( CreateRpCache( config.get_section( "cache" ) ) )
+      .Set( CreateDocValues( config.get_section( "doc_values" ) ) )
+      .Set( LoadRankers( config ) )
+      .Set( LoadCompression( config.get_section( "compression" ) ) )
       .Create();
   }
 
@@ -3,6 +3,17 @@
 # include "../reports.hpp"
 # include "../toolset.hpp"
 # include "collect.hpp"
+# include "executor.hpp"
+# include "search-cache.hpp"
+# include "search-stats.hpp"
+# include "doc-values.hpp"
+# include "collect-filter.hpp"
+# include "collect-order.hpp"
+# include "collect-facets.hpp"
+# include "collect-groups.hpp"
+# include "collect-rerank.hpp"
+# include "doc-arena.hpp"
+# include "bundle-zip.hpp"
 # include "structo/storage/posix-fs.hpp"
 # include "structo/indexer/layered-contents.hpp"
 # include "structo/enquote/quotations.hpp"
@@ -12,15 +23,37 @@
 # include "structo/context/pack-images.hpp"
 # include "structo/queries/builder.hpp"
 # include "DeliriX/DOM-load.hpp"
-# include <zlib.h>
+# include <mtc/recursive_shared_mutex.hpp>
+# include <condition_variable>
+# include <unordered_map>
+# include <shared_mutex>
+# include <mutex>
 
 namespace palmira {
 
+ /*
+  * StructoSearch
+  *
+  * Concurrency model: the methods may be called from any thread.
+  *
+  * The searches share the index lock and see the index unchanged until they finish,
+  * so the search reports and the cache generation are consistent.  The writers
+  * (Insert, BulkInsert, Update, Remove and Commit) form the single writer lane by
+  * the exclusive index lock held for the index modification only: the linguistic
+  * and the compression stages of the inserts run unlocked.  Commit() publishes the
+  * changes under the same exclusive lock, so the searches see either the index
+  * before the commit or after it.
+  *
+  * The field manager has it's own lock because the fields may be registered by the
+  * documents inserted; the lock order is the index, then the fields.
+  */
   class StructoSearch final: public IService
   {
     std::atomic_long  refCount = 0;
 
     class Timing;
+    class Shared;
+    struct Image;
 
     long  Attach() override;
     long  Detach() override;
@@ -30,15 +63,30 @@ namespace palmira {
     auto  Update( const UpdateArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Remove( const RemoveArgs&, NotifyFn ) -> mtc::api<IPending> override;
     auto  Search( const SearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  MSearch( const MSearchArgs&, NotifyFn ) -> mtc::api<IPending> override;
+    auto  BulkInsert( const BulkArgs&, NotifyFn ) -> mtc::api<IPending> override;
     void  Commit() override;
 
+    auto  MakeImage( const InsertArgs&, Image& ) -> Image&;
+    auto  SetImage( const InsertArgs&, Image& ) -> mtc::zmap;
+    auto  SetValues( const mtc::api<const IEntity>&, const mtc::zmap& ) -> mtc::zmap;
+    void  Sample( const std::vector<char>& );
+
+    auto  SearchOne( const SearchArgs&, const Timing&, bool& cached, Shared* = nullptr ) -> mtc::zmap;
+    auto  SearchDocs( const SearchArgs&, const Timing&, Shared* = nullptr ) -> mtc::zmap;
+
     template <size_t N>
     auto  DumpMetadata( const mtc::zmap&, char (&)[N] ) const -> std::pair<std::shared_ptr<char[]>, size_t>;
     auto  LoadMetadata( const mtc::api<const mtc::IByteBuffer>& ) const -> mtc::zmap;
 
   public:
     StructoSearch( mtc::api<IContentsIndex>, const context::Processor&,
-      const context::FieldManager&, FnContents = context::GetMiniContents );
+      const context::FieldManager&, FnContents = context::GetMiniContents,
+      std::shared_ptr<Executor> = nullptr,
+      std::shared_ptr<SearchCache> = nullptr,
+      std::shared_ptr<DocValues> = nullptr,
+      const Rankers& = {},
+      const Compression& = {} );
 
   private:
     auto  get_string( const mtc::zval& ) const -> mtc::charstr;
@@ -48,7 +96,24 @@ namespace palmira {
     context::Processor        lingProc;
     context::FieldManager     fieldMan;
     FnContents                contents;
-    bool                      modified = false;
+    std::shared_ptr<Executor> executor;
+    std::shared_ptr<SearchCache>  rpCache;
+    std::shared_ptr<DocValues>    docVals;    // typed metadata columns, optional
+    Rankers                   rankers;        // ranking plugins by name
+    std::atomic_uint64_t      ixGener = 0;    // index generation, bumped on each modification
+    SearchStats               stStats;        // phases histograms of the profiled searches
+    bool                      modified = false;   // guarded by mxIndex
+    std::shared_mutex         mxIndex;        // shared by the searches, exclusive for the writers
+    std::shared_mutex         mxFields;       // guards fieldMan
+
+  // quotation images compression
+    ZipOptions                zipOpts;        // the codec and the level, no dictionary
+    size_t                    nSample;        // images to be sampled for the zstd dictionary
+    size_t                    dictLen;        // the zstd dictionary size
+    std::shared_ptr<const ZipDictionary>  zipDict;  // trained dictionary, atomic access
+    std::vector<std::vector<char>>        samples;  // guarded by mxTrain
+    bool                      trained = false;    // guarded by mxTrain, once only
+    std::mutex                mxTrain;        // the lock order is train, then the index
   };
 
   class StructoSearch::Timing
@@ -57,19 +122,89 @@ namespace palmira {
     using time_point = clock_type::time_point;
 
   public:
+    Timing( const Executor* ex = nullptr, const SearchCache* rc = nullptr ):
+      actors( ex ), rcache( rc ) {}
+
+  public:
+    auto  expires( double timeout ) const -> time_point
+    {
+      return begin + std::chrono::duration_cast<clock_type::duration>( std::chrono::duration<double>( timeout ) );
+    }
     auto  elapced() const -> unsigned
     {
       return std::chrono::duration_cast<std::chrono::milliseconds>( clock_type::now() - begin ).count();
     }
+    auto  elapsed_us() const -> uint64_t
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - begin ).count();
+    }
     auto  operator()( const mtc::zmap& to ) const -> mtc::zmap
     {
+      auto  timer = mtc::zmap{
+        { "elapsed", elapced() } };
+
+      if ( actors != nullptr )
+        timer["executor"] = actors->GetMetrics();
+
+      if ( rcache != nullptr )
+      {
+        auto  metric = rcache->GetMetrics();
+
+        metric["cached"] = cached;
+        timer["cache"] = metric;
+      }
+
       return mtc::zmap( to, {
-        { "timer", mtc::zmap{
-          { "elapsed", elapced() } } } } );
+        { "timer", timer } } );
     };
 
+  public:
+    bool  cached = false;
+
   protected:
-    time_point  begin = clock_type::now();
+    time_point          begin = clock_type::now();
+    const Executor*     actors;
+    const SearchCache*  rcache;
+  };
+
+ /*
+  * StructoSearch::Shared
+  *
+  * The query built once for the batch searches having equal query and terms;
+  * each search gets it's own duplicate of the query to iterate.
+  */
+  class StructoSearch::Shared
+  {
+    std::once_flag            qbuilt;
+    std::mutex                mxLock;
+    mtc::api<queries::IQuery> pQuery;
+
+  public:
+    template <class BuildFn>
+    auto  Get( BuildFn build ) -> mtc::api<queries::IQuery>
+    {
+      std::call_once( qbuilt, [&](){  pQuery = build();  } );
+
+      if ( pQuery == nullptr )
+        return nullptr;
+
+      auto  exLock = mtc::make_unique_lock( mxLock );
+        return pQuery->Duplicate( { 0, pQuery->LastIndex() + 1 } );
+    }
+  };
+
+ /*
+  * StructoSearch::Image
+  *
+  * The document prepared to be indexed: the linguistic and the compression stages
+  * are done, so the index writer only stores it.  The images are reused for the
+  * next documents, so the buffers keep their capacity.
+  */
+  struct StructoSearch::Image
+  {
+    context::Contents           content;
+    std::vector<char>           extras;     // serialized metadata
+    std::vector<char>           bundle;     // serialized quotation image
   };
 
   class StructoService::data
@@ -79,6 +214,11 @@ namespace palmira {
     context::Processor        langProc;
     FnContents                contents = context::GetMiniContents;
     context::FieldManager     fieldMan;
+    std::shared_ptr<Executor> executor;
+    std::shared_ptr<SearchCache>  rpCache;
+    std::shared_ptr<DocValues>    docVals;
+    Rankers                   rankers;
+    Compression               zipping;
   };
 
   // StructoSearch implementation
@@ -87,11 +227,27 @@ namespace palmira {
     mtc::api<IContentsIndex>      ix,
     const context::Processor&     lp,
     const context::FieldManager&  fm,
-    FnContents                    cs ): ctxIndex( ix ), lingProc( lp ), contents( cs )
+    FnContents                    cs,
+    std::shared_ptr<Executor>     ex,
+    std::shared_ptr<SearchCache>  rc,
+    std::shared_ptr<DocValues>    dv,
+    const Rankers&                rp,
+    const Compression&            zc ): ctxIndex( ix ), lingProc( lp ), contents( cs ), executor( ex ), rpCache( rc ), docVals( dv ), rankers( rp ),
+      zipOpts{ GetCodec( zc.codec ), zc.level },
+      nSample( zc.codec == "zstd" ? zc.samples : 0 ),
+      dictLen( zc.dictlen )
   {
     auto  fdsEnt = ctxIndex->GetEntity( { "##__index_mappings__##", 22 } );
+    auto  zipEnt = ctxIndex->GetEntity( { "##__zstd_dictionary__##", 23 } );
     auto  extras = mtc::api<const mtc::IByteBuffer>();
 
+  // the images stored with the dictionary need it whatever the codec is now
+    if ( zipEnt != nullptr && (extras = zipEnt->GetExtra()) != nullptr && extras->GetLen() != 0 )
+    {
+      zipDict = std::make_shared<const ZipDictionary>( mtc::span<const char>( extras->GetPtr(), extras->GetLen() ), zc.level );
+      nSample = 0;
+    }
+
     if ( fdsEnt != nullptr && (extras = fdsEnt->GetExtra()) != nullptr )
     {
       auto  indata = mtc::array_zmap();
@@ -122,216 +278,702 @@ namespace palmira {
     return rCount;
   }
 
-  auto  ZipBuf( const mtc::span<const char>& src ) -> std::vector<char>
+  auto  StructoSearch::Insert( const InsertArgs& insert, NotifyFn notify ) -> mtc::api<IPending>
   {
-    auto  compressed_size = compressBound( src.size() );
-    auto  compressed_data = std::vector<char>( compressed_size );
-    auto  compress_result = compress( (Bytef*)compressed_data.data(), &compressed_size,
-      (const Bytef*)src.data(), src.size() );
-
-    if ( compress_result != Z_OK )
-      throw std::range_error( "compression failed" );
-
-    if ( compressed_size > src.size() - 100 )
-      throw std::range_error( "ignore compression" );
+    try
+    {
+      thread_local Image  pimage;   // the buffers reused by the inserts of the thread
 
-    return compressed_data.resize( compressed_size ), compressed_data;
+      return Immediate( SetImage( insert, MakeImage( insert, pimage ) ), notify );
+    }
+    catch ( const std::bad_function_call& xp )        {  return Immediate( UpdateReport{ EFAULT, xp.what() }, notify );  }
+    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
   }
 
-  auto  Unpack( const mtc::span<const char>& src ) -> std::vector<char>
+  auto  StructoSearch::Update( const UpdateArgs& update, NotifyFn notify ) -> mtc::api<IPending>
   {
-    std::vector<char> unpack( src.size() * 2 );
-    uLongf            length;
-    int               nerror;
+    try
+    {
+      char  buffer[0x400];
+      auto  serial = DumpMetadata( update.metadata, buffer );
+      auto  getdoc = mtc::api<const IEntity>();
+      auto  exlock = mtc::make_unique_lock( mxIndex );
+
+      if ( (getdoc = ctxIndex->SetExtras( update.objectId, { serial.first.get(), serial.second } )) == nullptr )
+        return exlock.unlock(), Immediate( UpdateReport{ ENOENT, "document not found" }, notify );
 
-    while ( (nerror = uncompress( (Bytef*)unpack.data(), &(length = unpack.size()),
-      (const Bytef*)src.data(), src.size() )) == Z_BUF_ERROR )
-        unpack.resize( unpack.size() * 3 / 2 );
+      ++ixGener, modified = true;
 
-    if ( nerror == Z_OK ) unpack.resize( length );
-      else unpack.clear();
+      auto  report = SetValues( getdoc, update.metadata );
+        exlock.unlock();
 
-    return unpack;
+      return Immediate( report, notify );
+    }
+    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
   }
 
-  auto  StructoSearch::Insert( const InsertArgs& insert, NotifyFn notify ) -> mtc::api<IPending>
+  auto  StructoSearch::Remove( const RemoveArgs& remove, NotifyFn notify ) -> mtc::api<IPending>
   {
     try
     {
-      char  buffer[0x400];
-      auto  serial = DumpMetadata( insert.metadata, buffer );
-      auto  mArena = mtc::Arena();
-      auto  pwBody = mArena.Create<context::BaseImage<mtc::Arena::allocator<char>>>();
-      auto  pwText = &insert.textview;
-      auto  utfdoc = DeliriX::Text();
       auto  getdoc = mtc::api<const IEntity>();
-      auto  enBeef = std::vector<char>();
+      auto  exlock = mtc::make_unique_lock( mxIndex );
 
-    // check if document is utf16-encoded; recode document if not so
-      if ( !IsEncoded( insert.textview, unsigned(-1) ) )
+    // get the entity index to clear the metadata columns
+      if ( docVals != nullptr )
+        getdoc = ctxIndex->GetEntity( remove.objectId );
+
+      if ( ctxIndex->DelEntity( remove.objectId ) )
       {
-        CopyUtf16( &utfdoc, insert.textview );
-        pwText = &utfdoc;
+        if ( getdoc != nullptr )
+          docVals->Del( getdoc->GetIndex() );
+        return ++ixGener, modified = true, exlock.unlock(), Immediate( UpdateReport( 0, "OK" ), notify );
       }
+      return exlock.unlock(), Immediate( UpdateReport( ENOENT, "document not found" ), notify );
+    }
+    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+  }
 
-    // create document image
-      lingProc.WordBreak( *pwBody, *pwText );
-      lingProc.SetMarkup( *pwBody, *pwText );
-      lingProc.Lemmatize( *pwBody );
+  auto  StructoSearch::Search( const SearchArgs& search, NotifyFn notify ) -> mtc::api<IPending>
+  {
+    Timing  timing( executor.get(), rpCache.get() );
+    auto    report = mtc::zmap();
+
+    if ( true )
+    {
+      auto  shlock = std::shared_lock<std::shared_mutex>( mxIndex );
 
-    // create quotation image
-      if ( true )
+      report = SearchOne( search, timing, timing.cached );
+    }
+    return Immediate( timing( report ), notify );
+  }
+
+ /*
+  * MSearch( msearch, notify )
+  *
+  * Runs the batch of searches concurrently on the shared executor and reports the
+  * array of the search reports in the order of the searches.  Equal searches are
+  * run once, and the searches having equal query and terms share the query built.
+  */
+  auto  StructoSearch::MSearch( const MSearchArgs& msearch, NotifyFn notify ) -> mtc::api<IPending>
+  {
+    Timing  timing( executor.get(), rpCache.get() );
+    auto    actors = Executor::Tasks( executor.get() );
+    auto    search = msearch.search;
+    auto    origin = std::vector<size_t>( search.size() );    // the search run for the equal ones
+    auto    shared = std::vector<std::shared_ptr<Shared>>( search.size() );
+    auto    report = std::vector<mtc::zmap>( search.size() );
+    auto    output = mtc::array_zmap();
+    auto    unique = std::unordered_map<std::string, size_t>();
+    auto    qshare = std::unordered_map<std::string, std::shared_ptr<Shared>>();
+    auto    ncache = std::atomic_uint( 0 );
+    auto    ntasks = size_t(0);
+
+    for ( size_t i = 0; i != search.size(); ++i )
+    {
+      if ( search[i].fTimeout <= 0.0 )
+        search[i].fTimeout = msearch.fTimeout;
+
+    // find the equal search already listed, else share the query with the equal ones
+      if ( (origin[i] = unique.emplace( SearchCache::MakeKey( search[i] ), i ).first->second) == i )
+      {
+        auto  keymap = mtc::zmap{ { "query", search[i].query }, { "terms", search[i].terms } };
+        auto  serial = std::string( keymap.GetBufLen(), '\0' );
+        auto& pquery = qshare[(keymap.Serialize( (char*)serial.data() ), serial)];
+
+        if ( pquery == nullptr )
+          pquery = std::make_shared<Shared>();
+
+        shared[i] = pquery;
+        ++ntasks;
+      }
+    }
+
+    auto  shlock = std::shared_lock<std::shared_mutex>( mxIndex );
+
+    for ( size_t i = 0; i != search.size(); ++i )
+      if ( origin[i] == i )
       {
-        auto  quoter = mtc::zmap{
-          { "ft", context::formats::Pack( pwBody->GetMarkup(), fieldMan ) } };
-        auto  limage = context::imaging::Pack( pwBody->GetTokens() );
+        actors.Insert( [&, i]()
+        {
+          bool  cached = false;
+
+        // the errors of the search are reported for the search only
+          try
+            {  report[i] = SearchOne( search[i], timing, cached, shared[i].get() );  }
+          catch ( const std::invalid_argument& xp )  {  report[i] = SearchReport( EINVAL, xp.what() );  }
+          catch ( const std::exception& xp )         {  report[i] = SearchReport( EFAULT, xp.what() );  }
+
+          if ( cached )
+            ++ncache;
+        } );
+      }
+
+    actors.Wait();
+    shlock.unlock();
+
+    for ( size_t i = 0; i != search.size(); ++i )
+      output.push_back( report[origin[i]] );
+
+    timing.cached = ntasks != 0 && ncache == ntasks;
 
-      // check if the image is big enough to compress it
+    return Immediate( timing( SearchReport( 0, "OK", {
+      { "reports", std::move( output ) } } ) ), notify );
+  }
+
+ /*
+  * BulkInsert( bulk, notify )
+  *
+  * Inserts the batch of documents and reports the array of the insert reports in
+  * the order of the batch.  The linguistic and the compression stages run on the
+  * shared executor, and the calling thread is the single index writer storing the
+  * images in the order of the batch.  The workers run ahead of the writer by the
+  * window of images only, and the writer prepares the images itself while the next
+  * one to be stored is not ready.
+  */
+  auto  StructoSearch::BulkInsert( const BulkArgs& bulk, NotifyFn notify ) -> mtc::api<IPending>
+  {
+    auto  actors = Executor::Tasks( executor.get() );
+    auto  nitems = bulk.insert.size();
+    auto  window = size_t(2 * actors.GetLimit());
+    auto  report = std::vector<mtc::zmap>( nitems );
+    auto  images = std::map<size_t, std::unique_ptr<Image>>();    // prepared and not stored yet
+    auto  spares = std::vector<std::unique_ptr<Image>>();         // stored, to be reused
+    auto  mxLock = std::mutex();
+    auto  cvNext = std::condition_variable();   // image prepared or stored
+    auto  ntaken = size_t(0);
+    auto  stored = size_t(0);
+    auto  nerror = uint32_t(0);
+    auto  output = mtc::array_zmap();
+
+  // the errors of the document are reported for the document only
+    auto  guarded = []( auto action ) -> mtc::zmap
+      {
         try
-        {  quoter.set_array_char( "ip", std::move( ZipBuf( limage ) ) );  }
-        catch ( const std::range_error& )
-        {  quoter.set_array_char( "im", std::move( limage ) ); }
+        {  return action();  }
+        catch ( const std::bad_function_call& xp )        {  return UpdateReport{ EFAULT, xp.what() };  }
+        catch ( const std::invalid_argument& xp )         {  return UpdateReport{ EINVAL, xp.what() };  }
+        catch ( const DeliriX::load_as::ParseError& xp )  {  return UpdateReport{ EINVAL, xp.what() };  }
+        catch ( const std::exception& xp )                {  return UpdateReport{ EFAULT, xp.what() };  }
+      };
+  // takes the next document and prepares it's image out of the lock; null image means error
+    auto  prepare = [&]( std::unique_lock<std::mutex>& exlock )
+      {
+        auto  nindex = ntaken++;
+        auto  pimage = std::unique_ptr<Image>();
+
+        if ( !spares.empty() )
+          pimage = std::move( spares.back() ), spares.pop_back();
+
+        exlock.unlock();
+          if ( pimage == nullptr )
+            pimage = std::make_unique<Image>();
+          report[nindex] = guarded( [&]()
+            {  return MakeImage( bulk.insert[nindex], *pimage ), mtc::zmap();  } );
+        exlock.lock();
+
+        if ( report[nindex].empty() ) images.emplace( nindex, std::move( pimage ) );
+          else images.emplace( nindex, nullptr ), spares.push_back( std::move( pimage ) );
+        cvNext.notify_all();
+      };
+    auto  canTake = [&]()
+      {  return ntaken != nitems && ntaken < stored + window;  };
+
+    for ( unsigned i = 1; i < actors.GetLimit() && i < nitems; ++i )
+    {
+      actors.Insert( [&]()
+      {
+        auto  exlock = mtc::make_unique_lock( mxLock );
+
+        for ( ; ; )
+        {
+          cvNext.wait( exlock, [&](){  return ntaken == nitems || canTake();  } );
+
+          if ( ntaken == nitems )
+            return;
 
-        enBeef.resize( quoter.GetBufLen() );
-        quoter.Serialize( enBeef.data() );
+          prepare( exlock );
+        }
+      } );
+    }
+
+    for ( auto exlock = mtc::make_unique_lock( mxLock ); stored != nitems; )
+    {
+      auto  pfound = images.find( stored );
+      auto  pimage = std::unique_ptr<Image>();
+
+      if ( pfound == images.end() )
+      {
+        if ( canTake() )  prepare( exlock );
+          else cvNext.wait( exlock );
+        continue;
       }
 
-    // create text contents and index document
-      getdoc = ctxIndex->SetEntity( insert.objectId,
-        contents( pwBody->GetLemmas(), pwBody->GetMarkup(), fieldMan ),
-        { serial.first.get(), serial.second },
-        { enBeef.data(), enBeef.size() } );
+      pimage = std::move( pfound->second );
+        images.erase( pfound );
+
+      exlock.unlock();
+        if ( pimage != nullptr )
+          report[stored] = guarded( [&]() {  return SetImage( bulk.insert[stored], *pimage );  } );
+      exlock.lock();
 
-      return modified = true, Immediate( UpdateReport{ 0, "OK", {
-        { "metadata", LoadMetadata( getdoc->GetExtra() ) } } }, notify );
+      if ( pimage != nullptr )
+        spares.push_back( std::move( pimage ) );
+
+      ++stored;
+      cvNext.notify_all();
     }
-    catch ( const std::bad_function_call& xp )        {  return Immediate( UpdateReport{ EFAULT, xp.what() }, notify );  }
-    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
-    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+
+    actors.Wait();
+
+    for ( auto& next: report )
+    {
+      if ( next.get_zmap( "status", {} ).get_int32( "code", 0 ) != 0 )
+        ++nerror;
+      output.push_back( std::move( next ) );
+    }
+
+    return Immediate( StatusReport( 0, "OK", {
+      { "failed", nerror },
+      { "reports", std::move( output ) } } ), notify );
   }
 
-  auto  StructoSearch::Update( const UpdateArgs& update, NotifyFn notify ) -> mtc::api<IPending>
+ /*
+  * MakeImage( insert, image )
+  *
+  * Runs the linguistic and the compression stages of the insert; thread-safe.
+  *
+  * The lexemes and the markup are allocated in the arena of the thread released
+  * after the document, and the compression buffer is the thread's one, so the
+  * documents processed by the thread take no memory churn but the images.
+  */
+  auto  StructoSearch::MakeImage( const InsertArgs& insert, Image& image ) -> Image&
   {
-    try
+    thread_local std::vector<char> zipbuf;
+
+    auto  arenas = DocArena::Lease();
+    auto  anBody = context::BaseImage<DocArena::allocator_type>( arenas.get_allocator() );
+    auto  pwBody = &anBody;
+    auto  pwText = &insert.textview;
+    auto  utfdoc = DeliriX::Text();
+
+    image.extras.resize( insert.metadata.GetBufLen() );
+    insert.metadata.Serialize( image.extras.data() );
+
+  // check if document is utf16-encoded; recode document if not so
+    if ( !IsEncoded( insert.textview, unsigned(-1) ) )
     {
-      char  buffer[0x400];
-      auto  serial = DumpMetadata( update.metadata, buffer );
-      auto  getdoc = mtc::api<const IEntity>();
+      CopyUtf16( &utfdoc, insert.textview );
+      pwText = &utfdoc;
+    }
 
-      if ( (getdoc = ctxIndex->SetExtras( update.objectId, { serial.first.get(), serial.second } )) == nullptr )
-        return Immediate( UpdateReport{ ENOENT, "document not found" }, notify );
+  // create document image
+    lingProc.WordBreak( *pwBody, *pwText );
+    lingProc.SetMarkup( *pwBody, *pwText );
+    lingProc.Lemmatize( *pwBody );
+
+  // create text contents and the formats; the fields may be registered
+    auto  fdlock = mtc::make_unique_lock( mxFields );
+    auto  format = context::formats::Pack( pwBody->GetMarkup(), fieldMan );
+      image.content = contents( pwBody->GetLemmas(), pwBody->GetMarkup(), fieldMan );
+    fdlock.unlock();
+
+  // create quotation image
+    if ( true )
+    {
+      auto  quoter = mtc::zmap{
+        { "ft", std::move( format ) } };
+      auto  limage = context::imaging::Pack( pwBody->GetTokens() );
+
+      auto  zipopt = zipOpts;
+      auto  zdicts = std::atomic_load( &zipDict );
+
+    // the dictionary is used by the zstd codec only
+      if ( zipopt.codec == Codec::Zstd )
+        zipopt.dicts = zdicts.get();
+
+      if ( zdicts == nullptr && nSample != 0 )
+        Sample( limage );
 
-      return modified = true, Immediate( UpdateReport{ 0, "OK", {
-        { "metadata", LoadMetadata( getdoc->GetExtra() ) } } }, notify );
+    // the zlib images are stored in the legacy format readable by the older builds;
+    // the versioned images are written for the other codecs only
+      if ( zipopt.codec == Codec::Zlib )
+      {
+        try
+        {  quoter.set_array_char( "ip", std::vector<char>( ZipBuf( limage, zipbuf, zipopt.level ) ) );  }
+        catch ( const std::range_error& )
+        {  quoter.set_array_char( "im", std::move( limage ) ); }
+      }
+        else
+      quoter.set_array_char( "iz", std::vector<char>( PackImage( limage, zipopt, zipbuf ) ) );
+
+      image.bundle.resize( quoter.GetBufLen() );
+      quoter.Serialize( image.bundle.data() );
     }
-    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
-    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+    return image;
   }
 
-  auto  StructoSearch::Remove( const RemoveArgs& remove, NotifyFn notify ) -> mtc::api<IPending>
+ /*
+  * Sample( image )
+  *
+  * Collects the quotation images to train the zstd dictionary; the dictionary is
+  * trained once, stored to the index and used for the images inserted after.  The
+  * images inserted before are compressed without the dictionary and stay readable.
+  */
+  void  StructoSearch::Sample( const std::vector<char>& limage )
   {
-    try
+    auto  trlock = std::unique_lock<std::mutex>( mxTrain, std::try_to_lock );
+    auto  buffer = std::vector<char>();
+
+  // the images are sampled, so the busy lock skips the image instead of waiting
+    if ( !trlock.owns_lock() || trained )
+      return;
+
+    if ( (samples.push_back( limage ), samples.size()) < nSample )
+      return;
+
+    buffer = ZipDictionary::Train( samples, dictLen );
+      samples.clear();
+      samples.shrink_to_fit();
+    trained = true;
+
+  // too few or too small samples, the images are compressed without the dictionary
+    if ( buffer.empty() )
+      return;
+
+    auto  zdicts = std::make_shared<const ZipDictionary>( buffer, zipOpts.level );
+    auto  exlock = mtc::make_unique_lock( mxIndex );
+
+    ctxIndex->SetEntity( { "##__zstd_dictionary__##", 23 }, {}, { buffer.data(), buffer.size() } );
+      modified = true;
+
+    std::atomic_store( &zipDict, zdicts );
+  }
+
+ /*
+  * SetImage( insert, image )
+  *
+  * Indexes the document image prepared; the index writer stage of the insert
+  */
+  auto  StructoSearch::SetImage( const InsertArgs& insert, Image& image ) -> mtc::zmap
+  {
+    auto  exlock = mtc::make_unique_lock( mxIndex );
+    auto  getdoc = ctxIndex->SetEntity( insert.objectId,
+      std::move( image.content ),
+      { image.extras.data(), image.extras.size() },
+      { image.bundle.data(), image.bundle.size() } );
+
+    ++ixGener, modified = true;
+
+    return SetValues( getdoc, insert.metadata );
+  }
+
+ /*
+  * SetValues( entity, metadata )
+  *
+  * Stores the typed metadata columns of the document just indexed and reports the
+  * update; called under the exclusive index lock.  The document stays indexed if
+  * the columns fail, e.g. above 'max_docs', so the update is reported successful
+  * with the 'doc_values' error.
+  */
+  auto  StructoSearch::SetValues( const mtc::api<const IEntity>& getdoc, const mtc::zmap& metadata ) -> mtc::zmap
+  {
+    auto  report = mtc::zmap{
+      { "metadata", LoadMetadata( getdoc->GetExtra() ) } };
+
+    if ( docVals != nullptr )
     {
-      if ( ctxIndex->DelEntity( remove.objectId ) )
-        return modified = true, Immediate( UpdateReport( 0, "OK" ), notify );
-      return Immediate( UpdateReport( ENOENT, "document not found" ), notify );
+      try
+      {  docVals->Set( getdoc->GetIndex(), metadata );  }
+      catch ( const std::exception& xp )
+      {  report["doc_values"] = std::string( xp.what() );  }
     }
-    catch ( const std::invalid_argument& xp )         {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
-    catch ( const DeliriX::load_as::ParseError& xp )  {  return Immediate( UpdateReport{ EINVAL, xp.what() }, notify );  }
+    return UpdateReport( 0, "OK", report );
   }
 
-  auto  StructoSearch::Search( const SearchArgs& search, NotifyFn notify ) -> mtc::api<IPending>
+ /*
+  * SearchOne( search, timing, cached, shared )
+  *
+  * Gets the document by id or searches the documents using the reports cache
+  */
+  auto  StructoSearch::SearchOne( const SearchArgs& search, const Timing& timing, bool& cached, Shared* shared ) -> mtc::zmap
   {
-    Timing  timing;
-
     if ( search.query.get_type() == mtc::zval::z_zmap && search.query.get_zmap()->get( "id" ) != nullptr )
     {
       auto  ent_id = get_string( *search.query.get_zmap()->get( "id" ) );
       auto  getent = mtc::api<const IEntity>();
 
       if ( ent_id.empty() )
-        return Immediate( timing( SearchReport( EINVAL, "invalid 'id' data type, string expected" ) ), notify );
+        return SearchReport( EINVAL, "invalid 'id' data type, string expected" );
 
       if ( (getent = ctxIndex->GetEntity( ent_id )) != nullptr )
       {
-        return Immediate( timing( SearchReport( 0, "OK", {
+        return SearchReport( 0, "OK", {
           { "first", uint32_t(1) },
           { "found", uint32_t(1) },
           { "items", mtc::array_zmap{
-            { { "id", { getent->GetId().data(), getent->GetId().size() } } } } } } ) ), notify );
+            { { "id", { getent->GetId().data(), getent->GetId().size() } } } } } } );
       }
-      return Immediate( timing( SearchReport( ENOENT, "document not found" ) ), notify );
+      return SearchReport( ENOENT, "document not found" );
     }
       else
+  // the profiled searches are never cached
+    if ( rpCache != nullptr && !search.order.get_bool( "profile", false ) )
     {
-      auto  quotate = [this]( uint32_t id, const queries::Abstract& abstr ) -> mtc::array_zval
+      auto  skey = SearchCache::MakeKey( search );
+      auto  igen = ixGener.load();
+      auto  repo = mtc::zmap();
+
+      if ( (cached = rpCache->Get( skey, igen, repo )) == false )
+      {
+        repo = SearchDocs( search, timing, shared );
+
+      // interrupted searches are not cached
+        if ( repo.get( "partial" ) == nullptr && repo.get( "quotes_partial" ) == nullptr )
+          rpCache->Put( skey, igen, repo );
+      }
+      return repo;
+    }
+    return SearchDocs( search, timing, shared );
+  }
+
+  auto  StructoSearch::SearchDocs( const SearchArgs& search, const Timing& timing, Shared* shared ) -> mtc::zmap
+  {
+    auto  profile = search.order.get_bool( "profile", false );
+    auto  unpacked = std::atomic_uint64_t( 0 );
+    auto  zdicts = std::atomic_load( &zipDict );
+    auto  quotate = [this, &unpacked, zdicts]( uint32_t id, const queries::Abstract& abstr ) -> mtc::array_zval
+      {
+        auto  entity = ctxIndex->GetEntity( id );
+        auto  bundle = entity != nullptr ? entity->GetBundle() : nullptr;
+        auto  output = mtc::array_zval();
+
+        if ( bundle != nullptr )
         {
-          auto  entity = ctxIndex->GetEntity( id );
-          auto  bundle = entity != nullptr ? entity->GetBundle() : nullptr;
-          auto  output = mtc::array_zval();
+          const char* data;
+          auto        mkup = mtc::span<const char>();
+          auto        buff = std::vector<char>();
+          auto        text = mtc::span<const char>();
+          uint32_t    size;
+
+        // check for formats
+          if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "ft" )) != nullptr )
+          {
+            if ( *data++ != mtc::zval::z_array_char )
+              throw std::runtime_error( "invalid object package format" );
+            data = ::FetchFrom( data, size );
+              mkup = { data, size };
+          }
+        // check versioned image
+          if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "iz" )) != nullptr )
+          {
+            if ( *data++ != mtc::zval::z_array_char )
+              throw std::runtime_error( "invalid object package format" );
+            data = ::FetchFrom( data, size );
+              text = (buff = UnpackImage( { data, size }, zdicts.get() ));
+            unpacked += buff.size();
+          }
+            else
+        // check legacy compressed image
+          if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "ip" )) != nullptr )
+          {
+            if ( *data++ != mtc::zval::z_array_char )
+              throw std::runtime_error( "invalid object package format" );
+            data = ::FetchFrom( data, size );
+              text = (buff = Unpack( { data, size } ));
+            unpacked += buff.size();
+          }
+            else
+        // check legacy uncompressed image
+          if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "im" )) != nullptr )
+          {
+            if ( *data++ != mtc::zval::z_array_char )
+              throw std::runtime_error( "invalid object package format" );
+            data = ::FetchFrom( data, size );
+              text = { data, size };
+          }
 
-          if ( bundle != nullptr )
+          if ( !text.empty() )
           {
-            const char* data;
-            auto        mkup = mtc::span<const char>();
-            auto        buff = std::vector<char>();
-            auto        text = mtc::span<const char>();
-            uint32_t    size;
-
-          // check for formats
-            if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "ft" )) != nullptr )
-            {
-              if ( *data++ != mtc::zval::z_array_char )
-                throw std::runtime_error( "invalid object package format" );
-              data = ::FetchFrom( data, size );
-                mkup = { data, size };
-            }
-          // check compressed image
-            if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "ip" )) != nullptr )
-            {
-              if ( *data++ != mtc::zval::z_array_char )
-                throw std::runtime_error( "invalid object package format" );
-              data = ::FetchFrom( data, size );
-                text = (buff = Unpack( { data, size } ));
-            }
-              else
-          // check uncompressed image
-            if ( (data = mtc::zmap::serial::find( bundle->GetPtr(), "im" )) != nullptr )
-            {
-              if ( *data++ != mtc::zval::z_array_char )
-                throw std::runtime_error( "invalid object package format" );
-              data = ::FetchFrom( data, size );
-                text = { data, size };
-            }
-
-            if ( !text.empty() )
-              enquote::QuoteMachine( fieldMan ).Structured()( ZmapAsText( output ), text, mkup, abstr );
+            auto  fdlock = std::shared_lock<std::shared_mutex>( mxFields );
+
+            enquote::QuoteMachine( fieldMan ).Structured()( ZmapAsText( output ), text, mkup, abstr );
           }
-          return output;
-        };
+        }
+        return output;
+      };
+
+    auto  collect = collect::Documents()
+      .SetFirst( search.order.get_int32( "first", 1 ) )
+      .SetCount( search.order.get_int32( "count", 10 ) )
+      .SetQuote( quotate, search.order.get_double( "quote_timeout", -1.0 ) );
+
+    if ( executor != nullptr )
+      collect.SetAsync( executor.get(), std::max( search.order.get_int32( "threads", 0 ), 0 ) );
+
+    if ( profile )
+      collect.SetProfile( true );
+
+  // set the search deadline, partial results are returned after
+    if ( search.fTimeout > 0.0 )
+      collect.SetTimer( timing.expires( search.fTimeout ) );
+
+  // compile the metadata filter checked before ranking
+    if ( !search.filter.empty() )
+    {
+      if ( docVals == nullptr )
+        return SearchReport( EINVAL, "'filter' requires the 'doc_values' fields to be configured" );
 
-        mtc::ThreadPool actors;
+      try
+        {  collect.SetCheck( std::make_shared<collect::Filter>( search.filter, *docVals ) );  }
+      catch ( const std::invalid_argument& xp )
+        {  return SearchReport( EINVAL, xp.what() );  }
+    }
 
-      auto  collect = collect::Documents()
-        .SetFirst( search.order.get_int32( "first", 1 ) )
-        .SetCount( search.order.get_int32( "count", 10 ) )
-        .SetAsync( &actors )
-        .SetQuote( quotate ).Create();
-      auto  request = queries::BuildRichQuery( search.query, search.terms, ctxIndex, lingProc, fieldMan );
+  // order by the metadata fields with relevance as the tie-breaker
+    if ( search.order.get( "sort" ) != nullptr )
+    {
+      if ( docVals == nullptr )
+        return SearchReport( EINVAL, "'sort' requires the 'doc_values' fields to be configured" );
 
-      if ( request == nullptr )
-        return Immediate( timing( SearchReport( 0, "OK", { { "found", 0U } } ) ), notify );
+      try
+        {  collect.SetOrder( std::make_shared<collect::SortKeys>( *search.order.get( "sort" ), *docVals ) );  }
+      catch ( const std::invalid_argument& xp )
+        {  return SearchReport( EINVAL, xp.what() );  }
+    }
 
-      collect->Search( request );
+  // count the facets of all the documents found
+    if ( !search.facets.empty() )
+    {
+      if ( docVals == nullptr )
+        return SearchReport( EINVAL, "'facets' require the 'doc_values' fields to be configured" );
 
-      return Immediate( timing( SearchReport( collect->Finish( ctxIndex ) ) ), notify );
+      try
+        {  collect.SetFacet( std::make_shared<collect::FacetSpec>( search.facets, *docVals ) );  }
+      catch ( const std::invalid_argument& xp )
+        {  return SearchReport( EINVAL, xp.what() );  }
     }
+
+  // collapse the documents by the metadata field value
+    if ( search.order.get_charstr( "group_by" ) != nullptr )
+    {
+      if ( docVals == nullptr )
+        return SearchReport( EINVAL, "'group_by' requires the 'doc_values' fields to be configured" );
+
+      try
+        {
+          collect.SetGroup( std::make_shared<collect::GroupSpec>( *search.order.get_charstr( "group_by" ),
+            search.order.get_int32( "group_size", 1 ), *docVals ) );
+        }
+      catch ( const std::invalid_argument& xp )
+        {  return SearchReport( EINVAL, xp.what() );  }
+    }
+
+  // rank by the plugin selected
+    if ( search.order.get_charstr( "ranker" ) != nullptr )
+    {
+      auto  pranker = rankers.find( *search.order.get_charstr( "ranker" ) );
+
+      if ( pranker == rankers.end() )
+        return SearchReport( EINVAL, "unknown 'ranker', the name of the ranker declared in 'rankers' expected" );
+
+      collect.SetRange( pranker->second );
+    }
+
+  // rerank the best documents of the first phase by the richer features
+    if ( search.order.get_zmap( "rerank" ) != nullptr )
+    {
+      try
+        {
+          auto  rerank = std::make_shared<collect::RerankSpec>( *search.order.get_zmap( "rerank" ), docVals.get() );
+
+          collect.SetRerank( [rerank]( uint32_t id, double weight, const queries::Abstract& abstr )
+            {  return (*rerank)( id, weight, abstr );  }, rerank->GetWindow() );
+        }
+      catch ( const std::invalid_argument& xp )
+        {  return SearchReport( EINVAL, xp.what() );  }
+    }
+
+  // select counting modes skipping ranking and quotation
+    if ( search.order.get_charstr( "mode" ) != nullptr )
+    {
+      auto& dwmode = *search.order.get_charstr( "mode" );
+
+      if ( dwmode == "count" )    collect.SetMode( collect::Documents::Mode::Count );
+        else
+      if ( dwmode == "estimate" ) collect.SetMode( collect::Documents::Mode::Estimate );
+        else
+      if ( dwmode != "ranked" )
+        return SearchReport( EINVAL, "invalid search 'mode', 'ranked', 'count' or 'estimate' expected" );
+    }
+
+  // continue from the cursor reported by the previous page
+    if ( search.order.get_charstr( "after" ) != nullptr )
+    {
+      try
+        {  collect.SetAfter( *search.order.get_charstr( "after" ) );  }
+      catch ( const std::invalid_argument& )
+        {  return SearchReport( EINVAL, "invalid 'after' cursor, the 'cursor' reported has to be passed" );  }
+    }
+
+    auto  tbuild = timing.elapsed_us();
+    auto  qbuild = [&]()
+      {
+        auto  fdlock = std::shared_lock<std::shared_mutex>( mxFields );
+
+        return queries::BuildRichQuery( search.query, search.terms, ctxIndex, lingProc, fieldMan );
+      };
+    auto  request = shared != nullptr ? shared->Get( qbuild ) : qbuild();
+
+    tbuild = timing.elapsed_us() - tbuild;
+
+    if ( request == nullptr )
+      return SearchReport( 0, "OK", { { "found", 0U } } );
+
+    auto  collector = mtc::api<collect::ICollector>();
+
+    try
+      {  collector = collect.Create();  }
+    catch ( const std::invalid_argument& xp )
+      {  return SearchReport( EINVAL, xp.what() );  }
+
+    collector->Search( request );
+
+    auto  report = collector->Finish( ctxIndex );
+
+  // complete the collector profile and feed the server histograms
+    if ( profile && report.get_zmap( "profile" ) != nullptr )
+    {
+      auto  zstats = *report.get_zmap( "profile" );
+
+      zstats["build_us"] = tbuild;
+      zstats["unpacked"] = unpacked.load();
+      zstats["total_us"] = timing.elapsed_us();
+
+      stStats.Add( SearchStats::Build,  tbuild );
+      stStats.Add( SearchStats::Search, zstats.get_word64( "search_us", 0 ) );
+      stStats.Add( SearchStats::Merge,  zstats.get_word64( "merge_us", 0 ) );
+      stStats.Add( SearchStats::Rerank, zstats.get_word64( "rerank_us", 0 ) );
+      stStats.Add( SearchStats::Quotes, zstats.get_word64( "quotes_us", 0 ) );
+      stStats.Add( SearchStats::Fetch,  zstats.get_word64( "fetch_us", 0 ) );
+      stStats.Add( SearchStats::Total,  zstats.get_word64( "total_us", 0 ) );
+
+      zstats["histograms"] = stStats.GetMetrics();
+      report["profile"] = std::move( zstats );
+    }
+    return SearchReport( report );
   }
 
   void  StructoSearch::Commit()
   {
+    auto  exlock = mtc::make_unique_lock( mxIndex );
+
     if ( modified )
     {
+      auto  fdlock = std::shared_lock<std::shared_mutex>( mxFields );
       auto  fields = SaveFields( fieldMan );
       auto  serial = std::vector<char>( GetBufLen( fields ) );
 
@@ -342,6 +984,11 @@ namespace palmira {
       modified = false;
     }
     ctxIndex->Commit();
+
+    if ( docVals != nullptr )
+      docVals->Sync();
+
+    ++ixGener;
   }
 
   template <size_t N>
@@ -417,6 +1064,46 @@ namespace palmira {
       return *this;
   }
 
+  auto  StructoService::Set( std::shared_ptr<Executor> exec ) -> StructoService&
+  {
+    if ( init == nullptr )
+      init = std::make_shared<data>();
+    init->executor = exec;
+      return *this;
+  }
+
+  auto  StructoService::Set( std::shared_ptr<SearchCache> cache ) -> StructoService&
+  {
+    if ( init == nullptr )
+      init = std::make_shared<data>();
+    init->rpCache = cache;
+      return *this;
+  }
+
+  auto  StructoService::Set( std::shared_ptr<DocValues> values ) -> StructoService&
+  {
+    if ( init == nullptr )
+      init = std::make_shared<data>();
+    init->docVals = values;
+      return *this;
+  }
+
+  auto  StructoService::Set( const Rankers& plugins ) -> StructoService&
+  {
+    if ( init == nullptr )
+      init = std::make_shared<data>();
+    init->rankers = plugins;
+      return *this;
+  }
+
+  auto  StructoService::Set( const Compression& settings ) -> StructoService&
+  {
+    if ( init == nullptr )
+      init = std::make_shared<data>();
+    init->zipping = settings;
+      return *this;
+  }
+
   auto  StructoService::Create() -> mtc::api<IService>
   {
     if ( init->contents == nullptr )
@@ -427,7 +1114,12 @@ namespace palmira {
       init->ctxIndex,
       init->langProc,
       init->fieldMan,
-      init->contents );
+      init->contents,
+      init->executor,
+      init->rpCache,
+      init->docVals,
+      init->rankers,
+      init->zipping );
   }
 
 }
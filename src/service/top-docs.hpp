@@ -0,0 +1,191 @@
+# if !defined( __palmira_src_service_top_docs_hpp__ )
+# define __palmira_src_service_top_docs_hpp__
+# include <algorithm>
+# include <cstdint>
+# include <utility>
+
+namespace palmira {
+namespace collect {
+
+ /*
+  * TopDocs<Differ>
+  *
+  * Bounded 4-ary heap of the best documents found with the worst document on the top.
+  *
+  * Identifiers and weights are kept in separate arrays provided by the owner, so the
+  * four children of a node are compared as contiguous vectors and the check against
+  * the worst document touches one value only.
+  *
+  * The documents may be ordered by the sort keys packed to nwidth words: the keys are
+  * kept in the array of limit + 1 slots provided by the owner, the last slot is used
+  * by Sort(), and compared as the arrays of integers before the documents.
+  *
+  * Differ( d1, f1, d2, f2 ) returns negative value if (d1, f1) has to be placed before
+  * (d2, f2), i.e. is better; it orders the documents having equal keys.
+  */
+  template <class Differ>
+  class TopDocs
+  {
+    enum: unsigned {  arity = 4  };
+
+  public:
+    TopDocs( uint32_t* pids, double* pwts, unsigned limit, Differ fcmp, uint64_t* pkeys = nullptr, unsigned nkeys = 0 ):
+      docids( pids ),
+      weight( pwts ),
+      keyset( pkeys ),
+      nlimit( limit ),
+      nwidth( nkeys ),
+      differ( fcmp ) {}
+
+  public:
+    auto  size() const -> unsigned  {  return ncount;  }
+    auto  limit() const -> unsigned {  return nlimit;  }
+    auto  width() const -> unsigned {  return nwidth;  }
+    auto  GetIds() const -> const uint32_t* {  return docids;  }
+    auto  GetWts() const -> const double*   {  return weight;  }
+    auto  GetKeys( unsigned pos ) const -> const uint64_t*  {  return keyset + size_t(pos) * nwidth;  }
+
+   /*
+    * Accept( id, weight, keys )
+    *
+    * Checks if the document would be inserted to the heap
+    */
+    bool  Accept( uint32_t id, double wt, const uint64_t* keys = nullptr ) const
+    {
+      return ncount < nlimit || (nlimit != 0 && Differs( id, wt, keys, 0 ) < 0);
+    }
+
+   /*
+    * Insert( id, weight, keys )
+    *
+    * Inserts accepted document to the heap; returns the id of the document evicted
+    * or uint32_t(-1) if the heap was not full
+    */
+    auto  Insert( uint32_t id, double wt, const uint64_t* keys = nullptr ) -> uint32_t
+    {
+      if ( ncount < nlimit )
+        return SiftUp( ncount++, id, wt, keys ), uint32_t(-1);
+
+      auto  evicted = docids[0];
+        SiftDown( 0, id, wt, keys, ncount );
+      return evicted;
+    }
+
+   /*
+    * Sort()
+    *
+    * Orders the documents from the best to the worst in place; the heap is read-only
+    * after sorting.
+    */
+    void  Sort()
+    {
+      auto  spare = keyset + size_t(nlimit) * nwidth;
+
+      for ( auto nsize = ncount; nsize > 1; --nsize )
+      {
+        auto  lastid = docids[nsize - 1];
+        auto  lastwt = weight[nsize - 1];
+
+        std::copy_n( GetKeys( nsize - 1 ), nwidth, spare );
+        Move( nsize - 1, 0 );
+
+        SiftDown( 0, lastid, lastwt, spare, nsize - 1 );
+      }
+    }
+
+   /*
+    * SetSize( count )
+    *
+    * Declares the count of the documents already placed to the arrays from the best
+    * to the worst by the owner, i.e. sorted; the heap is read-only then.
+    */
+    void  SetSize( unsigned count )
+    {
+      ncount = count;
+    }
+
+  protected:
+   /*
+    * Differs( id, weight, keys, pos )
+    *
+    * Compares the document to the one at the position passed
+    */
+    int   Differs( uint32_t id, double wt, const uint64_t* keys, unsigned pos ) const
+    {
+      auto  pkeys = GetKeys( pos );
+
+      for ( unsigned i = 0; i != nwidth; ++i )
+        if ( keys[i] != pkeys[i] )
+          return keys[i] < pkeys[i] ? -1 : 1;
+
+      return differ( id, wt, docids[pos], weight[pos] );
+    }
+
+    bool  IsWorse( unsigned l, unsigned r ) const
+      {  return Differs( docids[l], weight[l], GetKeys( l ), r ) > 0;  }
+
+    void  Move( unsigned to, unsigned from )
+    {
+      docids[to] = docids[from];
+      weight[to] = weight[from];
+
+      std::copy_n( GetKeys( from ), nwidth, keyset + size_t(to) * nwidth );
+    }
+
+    void  Store( unsigned to, uint32_t id, double wt, const uint64_t* keys )
+    {
+      docids[to] = id;
+      weight[to] = wt;
+
+      std::copy_n( keys, nwidth, keyset + size_t(to) * nwidth );
+    }
+
+    void  SiftUp( unsigned pos, uint32_t id, double wt, const uint64_t* keys )
+    {
+      while ( pos != 0 )
+      {
+        auto  parent = (pos - 1) / arity;
+
+        if ( Differs( id, wt, keys, parent ) <= 0 )
+          break;
+
+        Move( pos, parent );
+          pos = parent;
+      }
+      Store( pos, id, wt, keys );
+    }
+
+    void  SiftDown( unsigned pos, uint32_t id, double wt, const uint64_t* keys, unsigned nsize )
+    {
+      for ( unsigned first; (first = pos * arity + 1) < nsize; )
+      {
+        auto  climit = first + arity < nsize ? first + arity : nsize;
+        auto  pworst = first;
+
+        for ( auto child = first + 1; child < climit; ++child )
+          if ( IsWorse( child, pworst ) )
+            pworst = child;
+
+        if ( Differs( id, wt, keys, pworst ) >= 0 )
+          break;
+
+        Move( pos, pworst );
+          pos = pworst;
+      }
+      Store( pos, id, wt, keys );
+    }
+
+  protected:
+    uint32_t*   docids;
+    double*     weight;
+    uint64_t*   keyset;
+    unsigned    nlimit;
+    unsigned    nwidth;
+    unsigned    ncount = 0;
+    Differ      differ;
+
+  };
+
+}}
+
+# endif   // !__palmira_src_service_top_docs_hpp__
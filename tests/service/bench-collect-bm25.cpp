@@ -0,0 +1,133 @@
+# include "../../src/service/collect-bm25.hpp"
+# include "../../src/service/top-docs.hpp"
+# include <algorithm>
+# include <chrono>
+# include <random>
+# include <vector>
+# include <cstdio>
+# include <cmath>
+
+/*
+ * Compares the BM25 weights computed one document at a time, as the collector did
+ * before, with the blocks scored by the kernels, selecting the top documents
+ */
+
+using namespace palmira::collect;
+
+struct Factor
+{
+  double  dblIDF;
+};
+
+struct Abstract
+{
+  unsigned              nWords;
+  std::vector<Factor>   factors;
+};
+
+static int  CompareByRange( uint32_t d1, double f1, uint32_t d2, double f2 )
+{
+  int   res = (f1 < f2) - (f1 > f2);
+  return res != 0 ? res : (d1 > d2) - (d1 < d2);
+}
+
+using TopDocsFn = TopDocs<decltype(&CompareByRange)>;
+
+/*
+ * realistic abstracts: 1..4 query terms, most of the documents match a part
+ * of them, Zipf-like lengths from tens to thousands of words
+ */
+auto  MakeAbstracts( size_t count ) -> std::vector<Abstract>
+{
+  auto  random = std::mt19937( 17 );
+  auto  idfval = std::vector<double>{ 0.72, 0.41, 0.18, 0.09 };
+  auto  output = std::vector<Abstract>( count );
+
+  for ( auto& next: output )
+  {
+    next.nWords = unsigned(20.0 / std::pow( std::uniform_real_distribution<double>( 0.004, 1.0 )( random ), 1.2 ));
+
+    for ( auto idf: idfval )
+      if ( next.factors.empty() || random() % 3 != 0 )
+        next.factors.push_back( { idf * std::uniform_real_distribution<double>( 0.9, 1.0 )( random ) } );
+  }
+  return output;
+}
+
+auto  Scalar( const std::vector<Abstract>& abstracts, TopDocsFn& topdoc, BM25Block::Kernel ) -> unsigned
+{
+  for ( uint32_t id = 0; id != abstracts.size(); ++id )
+  {
+    auto&   tuples = abstracts[id];
+    double  weight = 1.0;
+
+    for ( auto& next: tuples.factors )
+      weight *= (1.0 - next.dblIDF);
+
+    weight = tuples.nWords != 0 ? (1.0 - weight) / log( 2 + tuples.nWords ) : 1.0 - weight;
+
+    if ( topdoc.Accept( id, weight ) )
+      topdoc.Insert( id, weight );
+  }
+  return topdoc.size();
+}
+
+auto  Blocks( const std::vector<Abstract>& abstracts, TopDocsFn& topdoc, BM25Block::Kernel kernel ) -> unsigned
+{
+  auto  block = BM25Block();
+  auto  flush = [&]()
+    {
+      auto  dfloor = topdoc.size() == topdoc.limit() ? topdoc.GetWts()[0] : -HUGE_VAL;
+      auto  passed = block.Score( dfloor, kernel );
+
+      for ( unsigned i = 0; passed != 0; ++i, passed >>= 1 )
+        if ( (passed & 1) != 0 && topdoc.Accept( block.GetId( i ), block.GetWeight( i ) ) )
+          topdoc.Insert( block.GetId( i ), block.GetWeight( i ) );
+      block.clear();
+    };
+
+  for ( uint32_t id = 0; id != abstracts.size(); ++id )
+  {
+    auto& tuples = abstracts[id];
+
+    block.Add( id, tuples.nWords, tuples.factors.data(), tuples.factors.data() + tuples.factors.size() );
+
+    if ( block.full() )
+      flush();
+  }
+  return flush(), topdoc.size();
+}
+
+template <class Select>
+double  Measure( Select select, const std::vector<Abstract>& abstracts, unsigned limit, BM25Block::Kernel kernel )
+{
+  auto  docids = std::vector<uint32_t>( limit );
+  auto  weight = std::vector<double>( limit );
+  auto  tstart = std::chrono::steady_clock::now();
+
+  for ( int i = 0; i != 5; ++i )
+  {
+    auto  topdoc = TopDocsFn( docids.data(), weight.data(), limit, &CompareByRange );
+
+    select( abstracts, topdoc, kernel );
+  }
+  return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - tstart ).count() / (5.0 * abstracts.size());
+}
+
+int   main()
+{
+  auto  abstracts = MakeAbstracts( 1000000 );
+
+  fprintf( stdout, "%6s %14s %14s %14s %14s\n", "limit", "scalar, ns/doc", "block, ns/doc", "sse2, ns/doc", "avx2, ns/doc" );
+
+  for ( auto limit: { 10U, 100U, 1000U } )
+  {
+    fprintf( stdout, "%6u %14.2f %14.2f %14.2f %14.2f\n", limit,
+      Measure( Scalar, abstracts, limit, BM25Block::Kernel::Scalar ),
+      Measure( Blocks, abstracts, limit, BM25Block::Kernel::Scalar ),
+      Measure( Blocks, abstracts, limit, BM25Block::Kernel::SSE2 ),
+      BM25Block::Supported( BM25Block::Kernel::AVX2 ) ? Measure( Blocks, abstracts, limit, BM25Block::Kernel::AVX2 ) : NAN );
+  }
+
+  return 0;
+}
@@ -0,0 +1,135 @@
+# include "../../src/service/doc-arena.hpp"
+# include "../../src/service/bundle-zip.hpp"
+# include "structo/context/processor.hpp"
+# include "structo/context/pack-images.hpp"
+# include "DeliriX/DOM-text.hpp"
+# include <atomic>
+# include <chrono>
+# include <cstdlib>
+# include <cstdio>
+# include <new>
+# include <zlib.h>
+
+/*
+ * Compares the heap allocations and the time per document taken by the document
+ * image and the compressed quotation image built as Insert did before, with the
+ * arena and the compression stream allocated for each document, and as it does
+ * now, with the arena and the stream of the thread reused
+ */
+
+static  std::atomic_uint64_t  nallocs( 0 );
+
+void* operator new( size_t size )
+{
+  void* palloc;
+
+  ++nallocs;
+
+  if ( (palloc = malloc( size != 0 ? size : 1 )) == nullptr )
+    throw std::bad_alloc();
+  return palloc;
+}
+
+void  operator delete( void* p ) noexcept
+{
+  free( p );
+}
+
+void  operator delete( void* p, size_t ) noexcept
+{
+  free( p );
+}
+
+using namespace structo;
+
+auto  MakeTexts( size_t count ) -> std::vector<DeliriX::Text>
+{
+  auto  output = std::vector<DeliriX::Text>( count );
+  auto  random = 17U;
+
+  for ( auto& next: output )
+  {
+    for ( int p = 0; p != 8; ++p )
+    {
+      auto  strtxt = std::string();
+
+      for ( int w = 0; w != 40; ++w )
+        strtxt += "word" + std::to_string( (random = random * 1103515245 + 12345) % 5000 ) + ' ';
+
+      next.AddBlock( strtxt.c_str() );
+    }
+  }
+  return output;
+}
+
+auto  Before( context::Processor& lingProc, const DeliriX::Text& text ) -> size_t
+{
+  auto  mArena = mtc::Arena();
+  auto  pwBody = mArena.Create<context::BaseImage<mtc::Arena::allocator<char>>>();
+  auto  limage = std::vector<char>();
+
+  lingProc.WordBreak( *pwBody, text );
+  lingProc.SetMarkup( *pwBody, text );
+  lingProc.Lemmatize( *pwBody );
+
+  limage = context::imaging::Pack( pwBody->GetTokens() );
+
+  auto  zipped = std::vector<char>( compressBound( limage.size() ) );
+  auto  ziplen = uLongf( zipped.size() );
+
+  compress( (Bytef*)zipped.data(), &ziplen, (const Bytef*)limage.data(), limage.size() );
+    zipped.resize( ziplen );
+
+  return zipped.size();
+}
+
+auto  After( context::Processor& lingProc, const DeliriX::Text& text ) -> size_t
+{
+  thread_local std::vector<char> zipbuf;
+
+  auto  arenas = palmira::DocArena::Lease();
+  auto  anBody = context::BaseImage<palmira::DocArena::allocator_type>( arenas.get_allocator() );
+  auto  limage = std::vector<char>();
+
+  lingProc.WordBreak( anBody, text );
+  lingProc.SetMarkup( anBody, text );
+  lingProc.Lemmatize( anBody );
+
+  limage = context::imaging::Pack( anBody.GetTokens() );
+
+  return palmira::ZipBuf( limage, zipbuf ).size();
+}
+
+template <class Build>
+void  Measure( const char* title, Build build, context::Processor& lingProc, const std::vector<DeliriX::Text>& texts )
+{
+  auto  nstart = nallocs.load();
+  auto  tstart = std::chrono::steady_clock::now();
+  auto  nbytes = size_t(0);
+
+  for ( auto& next: texts )
+    nbytes += build( lingProc, next );
+
+  fprintf( stdout, "%-8s %14.1f %14.2f %14.1f\n", title,
+    double(nallocs.load() - nstart) / texts.size(),
+    std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - tstart ).count() / texts.size(),
+    double(nbytes) / texts.size() );
+}
+
+int   main()
+{
+  auto  lingProc = context::Processor();
+  auto  texts = MakeTexts( 10000 );
+
+  fprintf( stdout, "%-8s %14s %14s %14s\n", "insert", "allocs/doc", "us/doc", "zipped/doc" );
+
+  Measure( "before", Before, lingProc, texts );
+  Measure( "after", After, lingProc, texts );
+
+  fprintf( stdout, "\narena documents: %llu, heap blocks: %llu, grown: %llu\n",
+    (unsigned long long)palmira::DocArena::GetMetrics().get_word64( "documents", 0 ),
+    (unsigned long long)palmira::DocArena::GetMetrics().get_word64( "allocations", 0 ),
+    (unsigned long long)palmira::DocArena::GetMetrics().get_word64( "grown", 0 ) );
+
+  return 0;
+}
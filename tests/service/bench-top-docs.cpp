@@ -0,0 +1,110 @@
+# include "../../src/service/top-docs.hpp"
+# include <functional>
+# include <algorithm>
+# include <chrono>
+# include <random>
+# include <vector>
+# include <cstdio>
+
+/*
+ * Compares the bounded heap selection of the best documents with the linear rescan
+ * of the worst one used by the collector before
+ */
+
+using DifferFn = std::function<int( uint32_t, double, uint32_t, double )>;
+
+static int  CompareByRange( uint32_t d1, double f1, uint32_t d2, double f2 )
+{
+  int   res = (f1 < f2) - (f1 > f2);
+  return res != 0 ? res : d1 - d2;
+}
+
+struct Entity
+{
+  uint32_t  id;
+  double    weight;
+};
+
+auto  LinearRescan( const std::vector<double>& values, unsigned limit, const DifferFn& differ ) -> uint32_t
+{
+  auto      buffer = std::vector<Entity>( limit );
+  auto      pWorst = (Entity*)nullptr;
+  unsigned  nCount = 0;
+
+  for ( uint32_t id = 0; id != values.size(); ++id )
+  {
+    auto  weight = values[id];
+
+    if ( nCount < limit )
+    {
+      buffer[nCount++] = { id, weight };
+    }
+      else
+    {
+      if ( pWorst == nullptr )
+        for ( auto beg = (pWorst = buffer.data()) + 1, end = buffer.data() + nCount; beg < end; ++beg )
+          if ( differ( pWorst->id, pWorst->weight, beg->id, beg->weight ) < 0 )
+            pWorst = beg;
+
+      if ( differ( id, weight, pWorst->id, pWorst->weight ) < 0 )
+      {
+        *pWorst = { id, weight };
+        pWorst = nullptr;
+      }
+    }
+  }
+  return nCount;
+}
+
+auto  BoundedHeap( const std::vector<double>& values, unsigned limit, const DifferFn& differ ) -> uint32_t
+{
+  struct Compare
+  {
+    const DifferFn& differ;
+
+    int   operator()( uint32_t d1, double f1, uint32_t d2, double f2 ) const
+      {  return differ( d1, f1, d2, f2 );  }
+  };
+
+  auto  docids = std::vector<uint32_t>( limit );
+  auto  weight = std::vector<double>( limit );
+  auto  topdoc = palmira::collect::TopDocs<Compare>( docids.data(), weight.data(), limit, { differ } );
+
+  for ( uint32_t id = 0; id != values.size(); ++id )
+    if ( topdoc.Accept( id, values[id] ) )
+      topdoc.Insert( id, values[id] );
+
+  return topdoc.size();
+}
+
+template <class Select>
+double  Measure( Select select, const std::vector<double>& values, unsigned limit )
+{
+  auto  differ = DifferFn( CompareByRange );
+  auto  tstart = std::chrono::steady_clock::now();
+
+  for ( int i = 0; i != 5; ++i )
+    select( values, limit, differ );
+
+  return std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - tstart ).count() / (5.0 * values.size());
+}
+
+int   main()
+{
+  auto  random = std::mt19937( 17 );
+  auto  values = std::vector<double>( 1000000 );
+
+  for ( auto& next: values )
+    next = std::uniform_real_distribution<double>( 0.0, 1.0 )( random );
+
+  fprintf( stdout, "%6s %14s %14s\n", "limit", "rescan, ns/doc", "heap, ns/doc" );
+
+  for ( auto limit: { 10U, 100U, 1000U, 10000U } )
+  {
+    fprintf( stdout, "%6u %14.2f %14.2f\n", limit,
+      Measure( LinearRescan, values, limit ),
+      Measure( BoundedHeap, values, limit ) );
+  }
+
+  return 0;
+}
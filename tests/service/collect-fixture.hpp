@@ -0,0 +1,154 @@
+# if !defined( __palmira_tests_service_collect_fixture_hpp__ )
+# define __palmira_tests_service_collect_fixture_hpp__
+# include "../../src/service/collect.hpp"
+# include "doc-values-fixture.hpp"
+# include <structo/indexer/layered-contents.hpp>
+# include <structo/storage/posix-fs.hpp>
+# include <algorithm>
+# include <atomic>
+# include <memory>
+# include <string>
+# include <tuple>
+# include <vector>
+
+namespace palmira {
+namespace testing {
+
+  using IQuery         = collect::IQuery;
+  using IContentsIndex = collect::IContentsIndex;
+  using Abstract       = collect::Abstract;
+
+ /*
+  * The argument and the result types of the query methods overridden are taken
+  * from the interface declarations
+  */
+  template <class M>
+  struct query_method;
+
+  template <class R, class C, class... A>
+  struct query_method<R (C::*)( A... )>
+  {
+    using result = R;
+    using args = std::tuple<A...>;
+  };
+
+ /*
+  * FakeQuery
+  *
+  * The query matching the documents listed with the weights set by the test.  Each
+  * document matched has the Rich abstract of the single entry of it's weight, so the
+  * built-in ranking orders the documents by the weights listed.  The duplicates are
+  * limited by the docid range as the index queries are; SearchDoc() calls counted.
+  */
+  class FakeQuery final: public IQuery
+  {
+    using DupMethod = query_method<decltype(&IQuery::Duplicate)>;
+    using GetMethod = query_method<decltype(&IQuery::GetTuples)>;
+
+  public:
+    struct Matches
+    {
+      std::vector<std::pair<uint32_t, double>>  docs;   // docid ascending
+      std::atomic<uint64_t>                     calls = 0;
+    };
+
+  public:
+    FakeQuery( std::shared_ptr<Matches> match, uint32_t lower = 0, uint32_t upper = uint32_t(-1) ):
+      matches( match ), uLower( lower ), uUpper( upper ) {}
+
+    static
+    auto  Create( std::shared_ptr<Matches> match ) -> mtc::api<IQuery>
+      {  return new FakeQuery( match );  }
+
+  public:
+    uint32_t  SearchDoc( uint32_t id ) override
+    {
+      auto  ptop = std::lower_bound( matches->docs.begin(), matches->docs.end(), std::max( id, uLower ),
+        []( const std::pair<uint32_t, double>& doc, uint32_t key ){  return doc.first < key;  } );
+
+      ++matches->calls;
+
+      return ptop != matches->docs.end() && ptop->first < uUpper ? ptop->first : uint32_t(-1);
+    }
+    auto  GetTuples( uint32_t id ) -> GetMethod::result override
+    {
+      auto  ptop = std::lower_bound( matches->docs.begin(), matches->docs.end(), id,
+        []( const std::pair<uint32_t, double>& doc, uint32_t key ){  return doc.first < key;  } );
+
+      entry = {};
+      tuples = {};
+
+      if ( ptop != matches->docs.end() && ptop->first == id && id >= uLower && id < uUpper )
+      {
+        entry.weight = ptop->second;
+
+        tuples.dwMode = Abstract::Rich;
+        tuples.nWords = 1;
+        tuples.entries.pbeg = &entry;
+        tuples.entries.pend = &entry + 1;
+      }
+        else
+      tuples.dwMode = Abstract::None;
+
+      return tuples;
+    }
+    uint32_t  LastIndex() override
+    {
+      return matches->docs.empty() ? 0 : matches->docs.back().first;
+    }
+    auto  Duplicate( std::tuple_element_t<0, DupMethod::args> range ) -> DupMethod::result override
+    {
+      auto  [lower, upper] = range;
+
+      return new FakeQuery( matches, std::max( uint32_t(lower), uLower ), std::min( uint32_t(upper), uUpper ) );
+    }
+
+  protected:
+    std::shared_ptr<Matches>  matches;
+    const uint32_t            uLower;
+    const uint32_t            uUpper;
+    Abstract::EntrySet        entry = {};
+    Abstract                  tuples = {};
+
+    implement_lifetime_control
+
+  };
+
+ /*
+  * ContentsDir
+  *
+  * The temporary layered index of the empty entities the collected documents are
+  * fetched from; the indices of the entities are listed ascending.
+  */
+  class ContentsDir final
+  {
+  public:
+    ContentsDir( const std::string& name, unsigned count ): ixroot( name )
+    {
+      ixtree = structo::indexer::layered::Index(
+        Open( structo::storage::posixFS::StoragePolicies::Open( ixroot.GetPath() + "/index" ) ) ).Create();
+
+      for ( unsigned i = 0; i != count; ++i )
+      {
+        auto  objid = "doc-" + std::to_string( i );
+
+        docids.push_back( ixtree->SetEntity( { objid.data(), objid.size() }, {}, {} )->GetIndex() );
+      }
+      std::sort( docids.begin(), docids.end() );
+    }
+
+  public:
+    auto  GetPath() const -> const std::string& {  return ixroot.GetPath();  }
+    auto  GetIndex() const -> mtc::api<IContentsIndex> {  return ixtree;  }
+    auto  GetDocIds() const -> const std::vector<uint32_t>& {  return docids;  }
+
+  protected:
+    ValuesDir                 ixroot;
+    mtc::api<IContentsIndex>  ixtree;
+    std::vector<uint32_t>     docids;
+
+  };
+
+}}
+
+# endif   // !__palmira_tests_service_collect_fixture_hpp__
@@ -0,0 +1,49 @@
+# if !defined( __palmira_tests_service_doc_values_fixture_hpp__ )
+# define __palmira_tests_service_doc_values_fixture_hpp__
+# include "../../src/service/doc-values.hpp"
+# include <filesystem>
+# include <stdexcept>
+# include <string>
+# include <unistd.h>
+
+namespace palmira {
+namespace testing {
+
+ /*
+  * ValuesDir
+  *
+  * The unique temporary directory of the test doc-values, removed with all it's
+  * contents as the test finishes; the concurrent test runs never share the files.
+  */
+  class ValuesDir final
+  {
+  public:
+    ValuesDir( const std::string& name ):
+      dvpath( (std::filesystem::temp_directory_path() / ("palmira-test-" + name + "-XXXXXX")).string() )
+    {
+      if ( ::mkdtemp( dvpath.data() ) == nullptr )
+        throw std::runtime_error( "could not create the test directory '" + dvpath + "'" );
+    }
+   ~ValuesDir()
+    {
+      auto  error = std::error_code();
+
+      std::filesystem::remove_all( dvpath, error );
+    }
+    ValuesDir( const ValuesDir& ) = delete;
+    ValuesDir& operator = ( const ValuesDir& ) = delete;
+
+  public:
+    auto  GetPath() const -> const std::string& {  return dvpath;  }
+
+    auto  Create( const mtc::zmap& fields, uint32_t maxdocs ) const -> DocValues
+      {  return DocValues( dvpath, fields, maxdocs );  }
+
+  protected:
+    std::string dvpath;
+
+  };
+
+}}
+
+# endif   // !__palmira_tests_service_doc_values_fixture_hpp__
@@ -0,0 +1,146 @@
+# include "../../src/service/bundle-zip.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <stdexcept>
+# include <string>
+# include <zlib.h>
+
+using namespace palmira;
+
+TestItEasy::RegisterFunc  test_bundle_zip( []()
+{
+  TEST_CASE( "service/bundle-zip" )
+  {
+    auto  source = std::string();
+
+    for ( int i = 0; i != 1000; ++i )
+      source += "the quotation image of the document number " + std::to_string( i % 37 ) + "; ";
+
+    SECTION( "the buffers are compressed as by compress()" )
+    {
+      auto  zipbuf = std::vector<char>();
+      auto  zipref = std::vector<char>( compressBound( source.size() ) );
+      auto  reflen = uLongf( zipref.size() );
+
+      compress( (Bytef*)zipref.data(), &reflen, (const Bytef*)source.data(), source.size() );
+        zipref.resize( reflen );
+
+      for ( int i = 0; i != 3; ++i )
+        REQUIRE( ZipBuf( source, zipbuf ) == zipref );
+    }
+    SECTION( "the buffers compressed are unpacked" )
+    {
+      auto  zipbuf = std::vector<char>();
+      auto  unpack = Unpack( ZipBuf( source, zipbuf ) );
+
+      REQUIRE( std::string( unpack.data(), unpack.size() ) == source );
+    }
+    SECTION( "the buffers not worth compressing are rejected" )
+    {
+      auto  zipbuf = std::vector<char>();
+      auto  random = std::string();
+
+      for ( unsigned i = 0, r = 17; i != 1000; ++i )
+        random.push_back( char((r = r * 1103515245 + 12345) >> 16) );
+
+      REQUIRE_EXCEPTION( ZipBuf( random, zipbuf ), std::range_error );
+    }
+  }
+  TEST_CASE( "service/bundle-zip/versioned" )
+  {
+    auto  source = std::string();
+    auto  random = std::string();
+
+    for ( int i = 0; i != 1000; ++i )
+      source += "the quotation image of the document number " + std::to_string( i % 37 ) + "; ";
+
+    for ( unsigned i = 0, r = 17; i != 1000; ++i )
+      random.push_back( char((r = r * 1103515245 + 12345) >> 16) );
+
+    SECTION( "the images are stored with the version, the codec and the length" )
+    {
+      auto  zipbuf = std::vector<char>();
+
+      PackImage( source, { Codec::Zlib }, zipbuf );
+
+      REQUIRE( zipbuf.size() < source.size() );
+      REQUIRE( zipbuf[0] == 1 );
+      REQUIRE( zipbuf[1] == char(Codec::Zlib) );
+      REQUIRE( (uint8_t(zipbuf[2]) | uint8_t(zipbuf[3]) << 8 | uint8_t(zipbuf[4]) << 16 | uint8_t(zipbuf[5]) << 24) == int(source.size()) );
+    }
+    SECTION( "the images are unpacked to the length recorded" )
+    {
+      auto  zipbuf = std::vector<char>();
+
+      for ( auto codec: { Codec::None, Codec::Zlib, Codec::LZ4, Codec::Zstd } )
+        if ( IsSupported( codec ) )
+        {
+          auto  unpack = UnpackImage( PackImage( source, { codec }, zipbuf ) );
+
+          REQUIRE( std::string( unpack.data(), unpack.size() ) == source );
+        }
+    }
+    SECTION( "the images not worth compressing are stored uncompressed" )
+    {
+      auto  zipbuf = std::vector<char>();
+
+      PackImage( random, { Codec::Zlib }, zipbuf );
+
+      REQUIRE( zipbuf[1] == char(Codec::None) );
+      REQUIRE( zipbuf.size() == random.size() + 6 );
+
+      auto  unpack = UnpackImage( zipbuf );
+
+      REQUIRE( std::string( unpack.data(), unpack.size() ) == random );
+    }
+    SECTION( "the invalid images are rejected" )
+    {
+      auto  zipbuf = std::vector<char>();
+
+      REQUIRE_EXCEPTION( UnpackImage( std::string( "\x01\x01" ) ), std::runtime_error );
+
+      PackImage( source, { Codec::Zlib }, zipbuf )[0] = 2;
+        REQUIRE_EXCEPTION( UnpackImage( zipbuf ), std::runtime_error );
+
+      PackImage( source, { Codec::Zlib }, zipbuf )[2] ^= 1;
+        REQUIRE_EXCEPTION( UnpackImage( zipbuf ), std::runtime_error );
+
+      PackImage( source, { Codec::Zlib }, zipbuf )[1] = 9;
+        REQUIRE_EXCEPTION( UnpackImage( zipbuf ), std::runtime_error );
+    }
+    SECTION( "the codecs are selected by name" )
+    {
+      REQUIRE( GetCodec( "zlib" ) == Codec::Zlib );
+      REQUIRE( GetCodec( "none" ) == Codec::None );
+      REQUIRE_EXCEPTION( GetCodec( "brotli" ), std::invalid_argument );
+    }
+# if defined( ZSTD_ENABLED )
+    SECTION( "the zstd images are compressed with the dictionary trained" )
+    {
+      auto  images = std::vector<std::vector<char>>();
+      auto  zipbuf = std::vector<char>();
+
+      for ( int i = 0; i != 200; ++i )
+      {
+        auto  sample = "the sample image " + std::to_string( i ) + " of the document " + source.substr( i * 7, 900 );
+
+        images.emplace_back( sample.begin(), sample.end() );
+      }
+
+      auto  trained = ZipDictionary::Train( images, 0x1000 );
+
+      REQUIRE( !trained.empty() );
+
+      auto  dicts = ZipDictionary( trained );
+      auto  plain = PackImage( images[3], { Codec::Zstd }, zipbuf ).size();
+      auto  dzipped = PackImage( images[3], { Codec::Zstd, 0, &dicts }, zipbuf );
+
+      REQUIRE( dzipped.size() < plain );
+      REQUIRE_EXCEPTION( UnpackImage( dzipped ), std::runtime_error );
+
+      auto  unpack = UnpackImage( dzipped, &dicts );
+
+      REQUIRE( unpack == images[3] );
+    }
+# endif
+  }
+} );
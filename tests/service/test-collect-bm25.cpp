@@ -0,0 +1,89 @@
+# include "../../src/service/collect-bm25.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <cstring>
+# include <random>
+# include <cmath>
+
+using namespace palmira::collect;
+
+struct Factor
+{
+  double  dblIDF;
+};
+
+static  bool  Identical( double l, double r )
+{
+  return memcmp( &l, &r, sizeof(double) ) == 0;
+}
+
+TestItEasy::RegisterFunc  test_collect_bm25( []()
+{
+  TEST_CASE( "service/collect-bm25" )
+  {
+    auto  random = std::mt19937( 17 );
+
+    SECTION( "weights match the scalar formula" )
+    {
+      for ( auto nwords: { 0.0, 1.0, 7.0, 100.0, 12345.0 } )
+      {
+        auto  factor = Factor{ 0.3 };
+        auto  result = BM25Block::Weight( 1.0 - factor.dblIDF, nwords );
+        auto  expect = nwords > 0.0 ? factor.dblIDF / log( 2 + nwords ) : factor.dblIDF;
+
+        REQUIRE( fabs( result - expect ) <= 1e-15 * expect );
+      }
+    }
+    SECTION( "all the kernels supported compute bit-identical weights" )
+    {
+      for ( int i = 0; i != 1000; ++i )
+      {
+        BM25Block blocks[3];
+        double    wfloor = 0.05;
+        uint32_t  passed[3];
+
+        for ( unsigned id = 0; id != BM25Block::block_size - unsigned(i % 3); ++id )
+        {
+          Factor    factor[6];
+          unsigned  nfacts = random() % 6;
+          double    nwords = random() % 5 == 0 ? 0 : random() % 10000;
+
+          for ( unsigned j = 0; j != nfacts; ++j )
+            factor[j].dblIDF = std::uniform_real_distribution<double>( 0.0, 0.95 )( random );
+
+          for ( auto& block: blocks )
+            block.Add( id, nwords, factor, factor + nfacts );
+        }
+
+        passed[0] = blocks[0].Score( wfloor, BM25Block::Kernel::Scalar );
+
+        for ( auto kernel: { BM25Block::Kernel::SSE2, BM25Block::Kernel::AVX2 } )
+          if ( BM25Block::Supported( kernel ) )
+          {
+            auto& block = blocks[unsigned(kernel)];
+
+            if ( !REQUIRE( (passed[unsigned(kernel)] = block.Score( wfloor, kernel )) == passed[0] ) )
+              return;
+
+            for ( unsigned j = 0; j != block.size(); ++j )
+              if ( !REQUIRE( Identical( block.GetWeight( j ), blocks[0].GetWeight( j ) ) ) )
+                return;
+          }
+      }
+    }
+    SECTION( "documents weighted below the floor are masked" )
+    {
+      auto    block = BM25Block();
+      Factor  strong[] = { { 0.9 }, { 0.8 } };
+      Factor  feeble[] = { { 0.01 } };
+
+      block.Add( 1, 10, strong, strong + 2 );
+      block.Add( 2, 10, feeble, feeble + 1 );
+      block.Add( 3, 0, strong, strong + 1 );
+
+      REQUIRE( block.Score( 0.1 ) == 0x5 );
+      REQUIRE( block.GetId( 2 ) == 3 );
+      REQUIRE( Identical( block.GetWeight( 2 ), 0.9 ) );
+      REQUIRE( block.Score( -HUGE_VAL ) == 0x7 );
+    }
+  }
+} );
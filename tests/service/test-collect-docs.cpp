@@ -0,0 +1,366 @@
+# include "../../src/service/collect.hpp"
+# include "../../src/service/collect-order.hpp"
+# include "collect-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <algorithm>
+# include <atomic>
+# include <cstring>
+# include <cmath>
+# include <string>
+# include <thread>
+# include <chrono>
+# include <vector>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+namespace {
+
+  using Matches = testing::FakeQuery::Matches;
+
+  auto  Collect( Documents search, std::shared_ptr<Matches> match, mtc::api<IContentsIndex> index ) -> mtc::zmap
+  {
+    auto  collect = search.Create();
+
+    collect->Search( testing::FakeQuery::Create( match ) );
+    return collect->Finish( index );
+  }
+
+  auto  GetItems( const mtc::zmap& report ) -> std::vector<uint32_t>
+  {
+    auto  pitems = report.get_array_zmap( "items" );
+    auto  output = std::vector<uint32_t>();
+
+    if ( pitems != nullptr )
+      for ( auto& next: *pitems )
+        output.push_back( next.get_word32( "index", 0 ) );
+
+    return output;
+  }
+
+  class ByIndex final: public IRanker
+  {
+    implement_lifetime_control
+
+  public:
+    void  Score( const Document* docs, size_t count, double* weights ) override
+    {
+      ++blocks;
+
+      for ( size_t i = 0; i != count; ++i )
+      {
+        if ( docs[i].tuples == nullptr || docs[i].tuples->dwMode != Abstract::Rich )
+          ++broken;
+        weights[i] = docs[i].id;
+      }
+    }
+
+  public:
+    std::atomic<unsigned> blocks = 0;
+    std::atomic<unsigned> broken = 0;
+
+  };
+
+  bool  Identical( double l, double r )
+  {
+    return memcmp( &l, &r, sizeof(double) ) == 0;
+  }
+
+}
+
+TestItEasy::RegisterFunc  test_collect_docs( []()
+{
+  TEST_CASE( "service/collect-docs" )
+  {
+    auto  ixroot = testing::ContentsDir( "collect-docs", 200 );
+    auto  dvroot = testing::ValuesDir( "collect-docs-values" );
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" } }, 0x10000 );
+    auto& docids = ixroot.GetDocIds();
+    auto  ranked = std::make_shared<Matches>();
+
+  // the weights and the sort keys have lots of ties
+    for ( size_t i = 0; i != docids.size(); ++i )
+    {
+      ranked->docs.push_back( { docids[i], (i % 5) * 0.25 } );
+      values.Set( docids[i], mtc::zmap{ { "year", int32_t(2000 + i % 3) } } );
+    }
+
+    SECTION( "the cursor keeps the document, the weight and the sort keys" )
+    {
+      auto  id = uint32_t(0);
+      auto  weight = 0.0;
+      auto  keys = std::vector<uint64_t>{ 7 };
+
+      if ( REQUIRE( Documents::LoadCursor( Documents::MakeCursor( 17, 0.625 ), id, weight, keys ) ) )
+      {
+        REQUIRE( id == 17 );
+        REQUIRE( Identical( weight, 0.625 ) );
+        REQUIRE( keys.empty() );
+      }
+      if ( REQUIRE( Documents::LoadCursor( Documents::MakeCursor( uint32_t(-1), -1.5, { 0, 1, uint64_t(-1) } ), id, weight, keys ) ) )
+      {
+        REQUIRE( id == uint32_t(-1) );
+        REQUIRE( Identical( weight, -1.5 ) );
+        REQUIRE( keys == std::vector<uint64_t>{ 0, 1, uint64_t(-1) } );
+      }
+    }
+    SECTION( "malformed and foreign version cursors are rejected" )
+    {
+      auto  cursor = Documents::MakeCursor( 17, 0.625, { 3 } );
+      auto  sorter = std::make_shared<const SortKeys>( mtc::zmap{ { "field", "year" } }, values );
+      auto  id = uint32_t(0);
+      auto  weight = 0.0;
+      auto  keys = std::vector<uint64_t>();
+
+      REQUIRE( !Documents::LoadCursor( "", id, weight, keys ) );
+      REQUIRE( !Documents::LoadCursor( cursor.substr( 0, cursor.length() - 1 ), id, weight, keys ) );
+      REQUIRE( !Documents::LoadCursor( cursor.substr( 0, cursor.length() - 2 ), id, weight, keys ) );
+      REQUIRE( !Documents::LoadCursor( cursor + "00", id, weight, keys ) );
+      REQUIRE( !Documents::LoadCursor( "zz" + cursor.substr( 2 ), id, weight, keys ) );
+      REQUIRE( !Documents::LoadCursor( "02" + cursor.substr( 2 ), id, weight, keys ) );
+
+      REQUIRE_EXCEPTION( Documents().SetAfter( "02" + cursor.substr( 2 ) ), std::invalid_argument );
+      REQUIRE_EXCEPTION( Documents().SetAfter( cursor ).Create(), std::invalid_argument );
+      REQUIRE_EXCEPTION( Documents().SetAfter( Documents::MakeCursor( 17, 0.625 ) ).SetOrder( sorter ).Create(), std::invalid_argument );
+    }
+    SECTION( "the pages after the cursor are the offset pages" )
+    {
+      auto  byyear = std::make_shared<const SortKeys>( mtc::zmap{ { "field", "year" }, { "order", "desc" } }, values );
+
+      for ( auto sorter: { std::shared_ptr<const SortKeys>(), byyear } )
+      {
+        auto  offset = std::vector<uint32_t>();
+        auto  follow = std::vector<uint32_t>();
+        auto  cursor = std::string();
+
+        for ( uint32_t first = 1; first <= docids.size(); first += 7 )
+        {
+          auto  search = Documents().SetFirst( first ).SetCount( 7 );
+
+          if ( sorter != nullptr )
+            search.SetOrder( sorter );
+
+          for ( auto id: GetItems( Collect( search, ranked, ixroot.GetIndex() ) ) )
+            offset.push_back( id );
+        }
+
+      // continue from the last document of the page until nothing left
+        for ( auto npages = 0; npages == 0 || (!cursor.empty() && npages <= 100); ++npages )
+        {
+          auto  search = Documents().SetCount( 7 );
+          auto  report = mtc::zmap();
+          auto  paged = std::vector<uint32_t>();
+
+          if ( sorter != nullptr )
+            search.SetOrder( sorter );
+          if ( !cursor.empty() )
+            search.SetAfter( cursor );
+
+          paged = GetItems( report = Collect( search, ranked, ixroot.GetIndex() ) );
+          cursor = !paged.empty() && report.get_charstr( "cursor" ) != nullptr ? *report.get_charstr( "cursor" ) : "";
+
+          follow.insert( follow.end(), paged.begin(), paged.end() );
+        }
+
+        REQUIRE( offset.size() == docids.size() );
+        REQUIRE( follow == offset );
+
+        std::sort( follow.begin(), follow.end() );
+
+        REQUIRE( follow == docids );
+      }
+    }
+    SECTION( "the count mode reports the exact count of the documents found" )
+    {
+      auto  actors = Executor( 4 );
+      auto  sparse = std::make_shared<Matches>();
+
+      for ( uint32_t id = 1; id < 200000; id += 3 )
+        sparse->docs.push_back( { id, 1.0 } );
+
+      for ( auto async: { false, true } )
+      {
+        auto  search = Documents().SetMode( Documents::Mode::Count );
+
+        if ( async )
+          search.SetAsync( &actors );
+
+        auto  report = Collect( search, sparse, nullptr );
+
+        REQUIRE( report.get_word32( "found", 0 ) == sparse->docs.size() );
+        REQUIRE( report.get( "estimate" ) == nullptr );
+        REQUIRE( report.get( "items" ) == nullptr );
+      }
+    }
+    SECTION( "the estimate mode reports the interval of the count extrapolated" )
+    {
+      auto  sparse = std::make_shared<Matches>();
+
+      for ( uint32_t id = 1; id < 200000; id += 3 )
+        sparse->docs.push_back( { id, 1.0 } );
+
+      auto  report = Collect( Documents().SetMode( Documents::Mode::Estimate ), sparse, nullptr );
+      auto  zrange = report.get_zmap( "estimate" );
+      auto  nfound = double(report.get_word32( "found", 0 ));
+      auto  nexact = double(sparse->docs.size());
+
+      if ( REQUIRE( zrange != nullptr ) )
+      {
+        REQUIRE( zrange->get_word32( "lower", uint32_t(-1) ) <= nfound );
+        REQUIRE( zrange->get_word32( "upper", 0 ) >= nfound );
+        REQUIRE( zrange->get_double( "sampled", 1.0 ) < 0.5 );
+      }
+      REQUIRE( fabs( nfound - nexact ) < nexact * 0.02 );
+
+    // the sampled sections are scanned only
+      REQUIRE( sparse->calls < sparse->docs.size() / 2 );
+
+    // the short ranges are counted exactly
+      report = Collect( Documents().SetMode( Documents::Mode::Estimate ), ranked, nullptr );
+
+      REQUIRE( report.get( "estimate" ) == nullptr );
+      REQUIRE( report.get_word32( "found", 0 ) == ranked->docs.size() );
+    }
+    SECTION( "the search past the deadline returns the partial result flagged" )
+    {
+      auto  actors = Executor( 4 );
+      auto  sparse = std::make_shared<Matches>();
+
+      for ( uint32_t id = 1; id < 200000; id += 3 )
+        sparse->docs.push_back( { id, 1.0 } );
+
+    // the deadline passed before the search started
+      for ( auto async: { false, true } )
+      {
+        auto  search = Documents().SetCount( 10 ).SetTimer( std::chrono::steady_clock::now() - std::chrono::seconds( 1 ) );
+
+        if ( async )
+          search.SetAsync( &actors );
+
+        sparse->calls = 0;
+
+        auto  report = Collect( search, sparse, nullptr );
+
+        REQUIRE( report.get_bool( "partial", false ) );
+        REQUIRE( report.get_word32( "found", 0 ) == 0 );
+        REQUIRE( sparse->calls < 10 );
+      }
+
+    // the deadline passed while the documents are ranked
+      {
+        auto  ixmore = testing::ContentsDir( "collect-docs-timer", 1000 );
+        auto  scored = std::make_shared<Matches>();
+        auto  nscore = 0;
+
+        for ( auto id: ixmore.GetDocIds() )
+          scored->docs.push_back( { id, 1.0 } );
+
+        auto  report = Collect( Documents().SetCount( 10 )
+          .SetRange( [&]( uint32_t, const Abstract& )
+            {
+              if ( nscore++ == 0 )
+                std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+              return 1.0;
+            } )
+          .SetTimer( std::chrono::steady_clock::now() + std::chrono::milliseconds( 10 ) ), scored, ixmore.GetIndex() );
+
+        REQUIRE( report.get_bool( "partial", false ) );
+        REQUIRE( report.get_word32( "found", 0 ) < scored->docs.size() );
+        REQUIRE( GetItems( report ).size() == 10 );
+      }
+    }
+    SECTION( "the ranker plugin scores drive the order" )
+    {
+      auto  ranker = mtc::api<ByIndex>( new ByIndex() );
+      auto  report = Collect( Documents().SetCount( 10 ).SetRange( mtc::api<IRanker>( ranker.ptr() ) ),
+        ranked, ixroot.GetIndex() );
+      auto  pitems = report.get_array_zmap( "items" );
+
+    // the plugin ranks the later documents first whatever the query weights are
+      if ( REQUIRE( pitems != nullptr ) && REQUIRE( pitems->size() == 10 ) )
+      {
+        for ( size_t i = 0; i != pitems->size(); ++i )
+        {
+          REQUIRE( pitems->at( i ).get_word32( "index", 0 ) == docids[docids.size() - i - 1] );
+          REQUIRE( Identical( pitems->at( i ).get_double( "range", 0.0 ), docids[docids.size() - i - 1] ) );
+        }
+      }
+
+    // the documents are scored by the blocks of 64
+      REQUIRE( ranker->blocks == (docids.size() + 63) / 64 );
+      REQUIRE( ranker->broken == 0 );
+    }
+    SECTION( "the parallel search results are the single-threaded ones" )
+    {
+      auto  ixmore = testing::ContentsDir( "collect-docs-parts", 5000 );
+      auto  dvmore = testing::ValuesDir( "collect-docs-parts-values" );
+      auto  fields = dvmore.Create( mtc::zmap{
+        { "year",   "int" } }, 0x10000 );
+      auto  actors = Executor( 4 );
+      auto  spread = std::make_shared<Matches>();
+      auto& sorted = ixmore.GetDocIds();
+
+      for ( size_t i = 0; i != sorted.size(); ++i )
+      {
+        spread->docs.push_back( { sorted[i], (i % 13) * 0.125 } );
+        fields.Set( sorted[i], mtc::zmap{ { "year", int32_t(1990 + i % 7) } } );
+      }
+
+      auto  byyear = std::make_shared<const SortKeys>( mtc::zmap{ { "field", "year" }, { "order", "desc" } }, fields );
+
+      for ( auto sorter: { std::shared_ptr<const SortKeys>(), byyear } )
+        for ( auto first: { 1U, 41U } )
+        {
+          auto  search = Documents().SetFirst( first ).SetCount( 40 ).SetProfile( true );
+
+          if ( sorter != nullptr )
+            search.SetOrder( sorter );
+
+          auto  single = Collect( search, spread, ixmore.GetIndex() );
+          auto  merged = Collect( search.SetAsync( &actors ), spread, ixmore.GetIndex() );
+          auto  sitems = single.get_array_zmap( "items" );
+          auto  mitems = merged.get_array_zmap( "items" );
+
+        // the documents were collected by the partitions
+          REQUIRE( single.get_zmap( "profile", {} ).get_array_zmap( "partitions" ) == nullptr );
+          REQUIRE( merged.get_zmap( "profile", {} ).get_array_zmap( "partitions" ) != nullptr );
+
+          REQUIRE( merged.get_word32( "found", 0 ) == spread->docs.size() );
+          REQUIRE( merged.get_word32( "found", 0 ) == single.get_word32( "found", 1 ) );
+          REQUIRE( merged.get_charstr( "cursor", "" ) == single.get_charstr( "cursor", "-" ) );
+
+          if ( REQUIRE( sitems != nullptr ) && REQUIRE( mitems != nullptr ) && REQUIRE( mitems->size() == sitems->size() ) )
+          {
+            for ( size_t i = 0; i != mitems->size(); ++i )
+            {
+              REQUIRE( mitems->at( i ).get_word32( "index", 0 ) == sitems->at( i ).get_word32( "index", 1 ) );
+              REQUIRE( Identical( mitems->at( i ).get_double( "range", 0.0 ), sitems->at( i ).get_double( "range", 1.0 ) ) );
+            }
+          }
+        }
+    }
+    SECTION( "the page is returned without the quotes over the quotation budget" )
+    {
+      auto  quoter = []( uint32_t id, const Abstract& ){  return mtc::array_zval{ mtc::zval( id ) };  };
+
+      for ( auto budget: { -1.0, 0.0 } )
+      {
+        auto  report = Collect( Documents().SetCount( 10 ).SetQuote( quoter, budget ), ranked, ixroot.GetIndex() );
+        auto  pitems = report.get_array_zmap( "items" );
+        auto  quoted = 0U;
+
+        if ( REQUIRE( pitems != nullptr ) && REQUIRE( pitems->size() == 10 ) )
+        {
+          for ( auto& next: *pitems )
+            quoted += next.get( "quote" ) != nullptr ? 1 : 0;
+        }
+
+      // no budget quotes all the documents, the exhausted one quotes none
+        REQUIRE( quoted == (budget < 0.0 ? 10U : 0U) );
+        REQUIRE( report.get_bool( "quotes_partial", false ) == (budget >= 0.0) );
+        REQUIRE( report.get( "partial" ) == nullptr );
+      }
+    }
+  }
+} );
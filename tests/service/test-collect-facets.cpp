@@ -0,0 +1,139 @@
+# include "../../src/service/collect-facets.hpp"
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <string>
+# include <vector>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+TestItEasy::RegisterFunc  test_collect_facets( []()
+{
+  TEST_CASE( "service/collect-facets" )
+  {
+    auto  dvroot = testing::ValuesDir( "collect-facets" );
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" },
+      { "author", "string" } }, 0x10000 );
+
+    for ( int i = 0; i != 100; ++i )
+    {
+      if ( i != 50 )
+        values.Set( i, mtc::zmap{
+          { "year",   1950 + i % 40 },
+          { "author", i % 4 == 0 ? "Pushkin" : i % 4 == 1 ? "Gogol" : "Tolstoy" } } );
+    }
+
+    SECTION( "invalid facets are rejected" )
+    {
+      REQUIRE_EXCEPTION( FacetSpec( mtc::zmap{ { "a", mtc::zmap{ { "field", "title" } } } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( FacetSpec( mtc::zmap{ { "a", mtc::zmap{ { "field", "year" }, { "type", "range" } } } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( FacetSpec( mtc::zmap{ { "a", mtc::zmap{ { "field", "author" }, { "type", "histogram" }, { "interval", 10 } } } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( FacetSpec( mtc::zmap{ { "a", mtc::zmap{ { "field", "year" }, { "type", "histogram" } } } }, values ), std::invalid_argument );
+    }
+    SECTION( "terms and histograms are counted and merged" )
+    {
+      auto  fspecs = FacetSpec( mtc::zmap{
+        { "authors", mtc::zmap{ { "field", "author" }, { "size", 2 } } },
+        { "decades", mtc::zmap{ { "field", "year" }, { "type", "histogram" }, { "interval", 10 } } } }, values );
+      auto  facet1 = Facets( fspecs );
+      auto  facet2 = Facets( fspecs );
+
+      for ( uint32_t id = 0; id != 100; ++id )
+        (id < 40 ? facet1 : facet2).Add( id );
+
+      facet1.Merge( facet2 );
+
+      auto  report = facet1.Report();
+      auto  author = report.get_array_zmap( "authors" );
+      auto  decade = report.get_array_zmap( "decades" );
+
+      if ( REQUIRE( author != nullptr ) && REQUIRE( author->size() == 2 ) )
+      {
+        REQUIRE( *author->at( 0 ).get_charstr( "value" ) == "Tolstoy" );
+        REQUIRE( *author->at( 0 ).get_word32( "count" ) == 49 );
+        REQUIRE( *author->at( 1 ).get_charstr( "value" ) == "Gogol" );
+        REQUIRE( *author->at( 1 ).get_word32( "count" ) == 25 );
+      }
+      if ( REQUIRE( decade != nullptr ) && REQUIRE( decade->size() == 4 ) )
+      {
+        REQUIRE( *decade->at( 0 ).get_int64( "value" ) == 1950 );
+        REQUIRE( *decade->at( 0 ).get_word32( "count" ) == 30 );
+        REQUIRE( *decade->at( 1 ).get_word32( "count" ) == 29 );
+        REQUIRE( *decade->at( 3 ).get_int64( "value" ) == 1980 );
+        REQUIRE( *decade->at( 3 ).get_word32( "count" ) == 20 );
+      }
+    }
+    SECTION( "histogram intervals are limited by the size" )
+    {
+      auto  fspecs = FacetSpec( mtc::zmap{
+        { "years", mtc::zmap{ { "field", "year" }, { "type", "histogram" }, { "interval", 1 }, { "size", 5 } } },
+        { "small", mtc::zmap{ { "field", "year" }, { "type", "histogram" }, { "interval", 1e-15 }, { "size", 5 } } },
+        { "halfs", mtc::zmap{ { "field", "year" }, { "type", "histogram" }, { "interval", 2.5 } } } }, values );
+      auto  facets = Facets( fspecs );
+
+      for ( uint32_t id = 0; id != 100; ++id )
+        facets.Add( id );
+
+      auto  report = facets.Report();
+      auto  nyears = report.get_array_zmap( "years" );
+      auto  nsmall = report.get_array_zmap( "small" );
+      auto  nhalfs = report.get_array_zmap( "halfs" );
+
+    // the most frequent intervals are listed ascending
+      if ( REQUIRE( nyears != nullptr ) && REQUIRE( nyears->size() == 5 ) )
+      {
+        for ( int i = 0; i != 5; ++i )
+        {
+          REQUIRE( *nyears->at( i ).get_int64( "value" ) == 1950 + i );
+          REQUIRE( *nyears->at( i ).get_word32( "count" ) == 3 );
+        }
+      }
+      if ( REQUIRE( nsmall != nullptr ) )
+        REQUIRE( nsmall->size() == 5 );
+      if ( REQUIRE( nhalfs != nullptr ) && REQUIRE( nhalfs->size() == 16 ) )
+      {
+        REQUIRE( *nhalfs->at( 0 ).get_int64( "value" ) == 1950 );
+        REQUIRE( nhalfs->at( 1 ).get( "value" )->get_type() == mtc::zval::z_double );
+        REQUIRE( *nhalfs->at( 2 ).get_int64( "value" ) == 1955 );
+      }
+    }
+    SECTION( "limited histograms do not depend on the partial counters" )
+    {
+      auto  fspecs = FacetSpec( mtc::zmap{
+        { "years", mtc::zmap{ { "field", "year" }, { "type", "histogram" }, { "interval", 1 }, { "size", 5 } } } }, values );
+      auto  single = Facets( fspecs );
+
+      for ( uint32_t id = 0; id != 100; ++id )
+        single.Add( id );
+
+      auto  sample = single.Report();
+      auto  expect = sample.get_array_zmap( "years" );
+
+    // the documents interleaved and split by the ranges, the last parts filled first
+      for ( auto split: { 0, 1 } )
+      {
+        auto  merged = Facets( fspecs );
+        auto  counts = std::vector<Facets>( 4, Facets( fspecs ) );
+
+        for ( uint32_t id = 100; id-- != 0; )
+          counts[split == 0 ? id % 4 : id / 25].Add( id );
+
+        for ( auto& next: counts )
+          merged.Merge( next );
+
+        auto  report = merged.Report();
+        auto  listed = report.get_array_zmap( "years" );
+
+        if ( REQUIRE( expect != nullptr ) && REQUIRE( listed != nullptr ) && REQUIRE( listed->size() == expect->size() ) )
+        {
+          for ( size_t i = 0; i != listed->size(); ++i )
+          {
+            REQUIRE( *listed->at( i ).get_int64( "value" ) == *expect->at( i ).get_int64( "value" ) );
+            REQUIRE( *listed->at( i ).get_word32( "count" ) == *expect->at( i ).get_word32( "count" ) );
+          }
+        }
+      }
+    }
+  }
+} );
@@ -0,0 +1,84 @@
+# include "../../src/service/collect-filter.hpp"
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <string>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+TestItEasy::RegisterFunc  test_collect_filter( []()
+{
+  TEST_CASE( "service/collect-filter" )
+  {
+    auto  dvroot = testing::ValuesDir( "collect-filter" );
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" },
+      { "price",  "double" },
+      { "pages",  "uint" },
+      { "author", "string" } }, 0x10000 );
+    auto  select = [&]( const mtc::zmap& filter )
+      {
+        auto  ncount = 0;
+        auto  check = Filter( filter, values );
+
+        for ( uint32_t id = 0; id != 200; ++id )
+          ncount += check.Check( id ) ? 1 : 0;
+        return ncount;
+      };
+
+    for ( int i = 0; i != 100; ++i )
+    {
+      values.Set( i, mtc::zmap{
+        { "year",   1950 + i },
+        { "price",  i * 0.5 },
+        { "pages",  100 + i },
+        { "author", i % 3 == 0 ? "Pushkin" : i % 3 == 1 ? "Gogol" : "Tolstoy" } } );
+    }
+
+    SECTION( "numeric ranges select the documents with values only" )
+    {
+      REQUIRE( select( { { "field", "year" }, { "gte", 1990 }, { "lt", 2000 } } ) == 10 );
+      REQUIRE( select( { { "field", "year" }, { "gt", 1990 }, { "lte", 2000 } } ) == 10 );
+      REQUIRE( select( { { "field", "year" }, { "eq", 1990 } } ) == 1 );
+      REQUIRE( select( { { "field", "price" }, { "gt", 10.0 } } ) == 79 );
+      REQUIRE( select( { { "field", "pages" }, { "gte", 150 }, { "lt", 160 } } ) == 10 );
+    }
+    SECTION( "fractional bounds of the integer fields are rounded by the operator" )
+    {
+      REQUIRE( select( { { "field", "year" }, { "gte", 1990.5 }, { "lt", 2000 } } ) == 9 );
+      REQUIRE( select( { { "field", "year" }, { "gt", 1989.5 }, { "lte", 1999.5 } } ) == 10 );
+      REQUIRE( select( { { "field", "year" }, { "lt", 1953.5 } } ) == 4 );
+      REQUIRE( select( { { "field", "year" }, { "eq", 1990.5 } } ) == 0 );
+      REQUIRE( select( { { "field", "year" }, { "eq", 1990.0 } } ) == 1 );
+      REQUIRE( select( { { "field", "year" }, { "lte", 1e30 } } ) == 100 );
+      REQUIRE( select( { { "field", "year" }, { "gte", -1e30 } } ) == 100 );
+      REQUIRE( select( { { "field", "year" }, { "gt", 1e30 } } ) == 0 );
+      REQUIRE( select( { { "field", "pages" }, { "gt", 150.5 }, { "lte", 160 } } ) == 10 );
+      REQUIRE( select( { { "field", "pages" }, { "in", mtc::array_zval{ 150, 150.5, 151 } } } ) == 2 );
+    }
+    SECTION( "string IN-lists and inequality" )
+    {
+      REQUIRE( select( { { "field", "author" }, { "in", mtc::array_charstr{ "Pushkin", "Gogol" } } } ) == 67 );
+      REQUIRE( select( { { "field", "author" }, { "ne", "Pushkin" } } ) == 166 );
+    }
+    SECTION( "boolean combinations" )
+    {
+      REQUIRE( select( { { "and", mtc::array_zmap{
+        { { "field", "author" }, { "eq", "Gogol" } },
+        { { "field", "year" }, { "lt", 1960 } } } } } ) == 3 );
+      REQUIRE( select( { { "or", mtc::array_zmap{
+        { { "field", "author" }, { "eq", "Gogol" } },
+        { { "field", "year" }, { "lt", 1960 } } } } } ) == 40 );
+      REQUIRE( select( { { "not", mtc::zmap{
+        { "field", "year" }, { "lt", 1960 } } } } ) == 190 );
+    }
+    SECTION( "invalid filters are rejected" )
+    {
+      REQUIRE_EXCEPTION( Filter( { { "field", "unknown" }, { "eq", 1 } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( Filter( { { "field", "author" }, { "gt", "A" } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( Filter( { { "field", "year" } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( Filter( { { "field", "pages" }, { "gt", -1 } }, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( Filter( { { "field", "pages" }, { "lte", -0.5 } }, values ), std::invalid_argument );
+    }
+  }
+} );
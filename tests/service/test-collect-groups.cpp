@@ -0,0 +1,104 @@
+# include "../../src/service/collect-groups.hpp"
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <algorithm>
+# include <random>
+# include <string>
+# include <map>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+static int  CompareByRange( uint32_t d1, double f1, uint32_t d2, double f2 )
+{
+  int   res = (f1 < f2) - (f1 > f2);
+  return res != 0 ? res : (d1 > d2) - (d1 < d2);
+}
+
+TestItEasy::RegisterFunc  test_collect_groups( []()
+{
+  TEST_CASE( "service/collect-groups" )
+  {
+    auto  dvroot = testing::ValuesDir( "collect-groups" );
+    auto  random = std::mt19937( 17 );
+    auto  weight = std::vector<double>( 10000 );
+
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" },
+      { "author", "string" } }, 0x10000 );
+
+    for ( uint32_t id = 0; id != weight.size(); ++id )
+    {
+      weight[id] = std::uniform_int_distribution<int>( 0, 1000 )( random ) / 1000.0;
+
+      if ( id % 101 != 0 )
+        values.Set( id, mtc::zmap{ { "author", "author-" + std::to_string( id % 97 ) } } );
+    }
+
+    SECTION( "invalid grouping is rejected" )
+    {
+      REQUIRE_EXCEPTION( GroupSpec( "title", 1, values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( GroupSpec( "author", 0, values ), std::invalid_argument );
+    }
+    SECTION( "the best groups and the best documents in each group are selected" )
+    {
+      auto  gspecs = GroupSpec( "author", 3, values );
+      auto  expect = std::map<std::string, std::vector<std::pair<uint32_t, double>>>();
+      auto  ranked = std::vector<std::pair<double, std::string>>();
+      auto  better = []( const std::pair<uint32_t, double>& l, const std::pair<uint32_t, double>& r )
+        {  return CompareByRange( l.first, l.second, r.first, r.second ) < 0;  };
+
+      for ( uint32_t id = 0; id != weight.size(); ++id )
+        expect[std::string( values.GetColumn( "author" )->GetString( id ) )].push_back( { id, weight[id] } );
+
+      for ( auto& next: expect )
+      {
+        std::sort( next.second.begin(), next.second.end(), better );
+        ranked.push_back( { next.second.front().second, next.first } );
+      }
+
+      for ( auto nparts: { 1, 4 } )
+      {
+        auto  groups = TopGroups<decltype(&CompareByRange)>( gspecs, 10, &CompareByRange );
+        auto  gparts = std::vector<TopGroups<decltype(&CompareByRange)>>( nparts, { gspecs, 10, &CompareByRange } );
+
+        for ( uint32_t id = 0; id != weight.size(); ++id )
+          gparts[id % nparts].Insert( id, weight[id] );
+
+        for ( auto& next: gparts )
+          groups.Merge( next );
+
+      // collect once again if some documents of the groups selected were dropped
+        if ( groups.Lossy() )
+        {
+          groups.Close();
+
+          for ( uint32_t id = 0; id != weight.size(); ++id )
+            if ( groups.Has( id ) )
+              groups.Insert( id, weight[id] );
+        }
+
+        groups.Sort();
+
+        if ( REQUIRE( groups.size() == 10 ) )
+        {
+          for ( unsigned i = 0; i != groups.size(); ++i )
+          {
+            auto  value = gspecs.GetValue( groups[i].first.first );
+            auto  group = expect[value.get_charstr() != nullptr ? *value.get_charstr() : std::string()];
+
+            if ( !REQUIRE( groups[i].found == group.size() ) )
+              break;
+            if ( !REQUIRE( groups[i].items.size() == 3 ) )
+              break;
+            for ( unsigned j = 0; j != 3; ++j )
+              REQUIRE( groups[i].items[j].first == group[j].first );
+            if ( i != 0 )
+              REQUIRE( CompareByRange( groups[i - 1].first.first, groups[i - 1].first.second,
+                groups[i].first.first, groups[i].first.second ) < 0 );
+          }
+        }
+      }
+    }
+  }
+} );
@@ -0,0 +1,85 @@
+# include "../../src/service/collect-order.hpp"
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <algorithm>
+# include <string>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+TestItEasy::RegisterFunc  test_collect_order( []()
+{
+  TEST_CASE( "service/collect-order" )
+  {
+    auto  dvroot = testing::ValuesDir( "collect-order" );
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" },
+      { "price",  "double" },
+      { "author", "string" } }, 0x10000 );
+
+    for ( int i = 0; i != 100; ++i )
+    {
+      if ( i != 50 )
+        values.Set( i, mtc::zmap{
+          { "year",   2000 - i % 10 },
+          { "price",  (i % 7) - 3.5 },
+          { "author", i % 3 == 0 ? "Pushkin" : i % 3 == 1 ? "Gogol" : "Tolstoy" } } );
+    }
+
+    SECTION( "documents are ordered by the packed keys" )
+    {
+      auto  sorter = SortKeys( mtc::array_zmap{
+        { { "field", "author" } },
+        { { "field", "price" }, { "order", "desc" } },
+        { { "field", "year" } } }, values );
+      auto  docids = std::vector<uint32_t>();
+      auto  sorted = true;
+
+      for ( uint32_t id = 0; id != 100; ++id )
+        docids.push_back( id );
+
+      std::sort( docids.begin(), docids.end(), [&]( uint32_t d1, uint32_t d2 )
+        {  return sorter.Compare( d1, 1.0, d2, 1.0 ) < 0;  } );
+
+      for ( size_t i = 1; i != docids.size() - 1; ++i )
+      {
+        auto  a1 = values.GetColumn( "author" )->GetString( docids[i - 1] );
+        auto  a2 = values.GetColumn( "author" )->GetString( docids[i] );
+        auto  p1 = values.GetColumn( "price" )->GetDouble( docids[i - 1] );
+        auto  p2 = values.GetColumn( "price" )->GetDouble( docids[i] );
+
+        sorted &= a1 < a2 || (a1 == a2 && p1 >= p2);
+      }
+
+      REQUIRE( sorter.Width() == 4 );
+      REQUIRE( sorted );
+      REQUIRE( docids.back() == 50 );
+    }
+    SECTION( "the cursor keys compare as the document" )
+    {
+      auto  sorter = SortKeys( mtc::zmap{ { "field", "year" }, { "order", "desc" } }, values );
+      auto  curkey = sorter.GetKeys( 3 );
+      auto  doc_01 = sorter.GetKeys( 1 );
+      auto  doc_05 = sorter.GetKeys( 5 );
+
+      REQUIRE( sorter.Compare( curkey.data(), 3, 1.0, curkey.data(), 3, 1.0 ) == 0 );
+      REQUIRE( sorter.Compare( doc_01.data(), 1, 1.0, curkey.data(), 3, 1.0 ) < 0 );
+      REQUIRE( sorter.Compare( doc_05.data(), 5, 1.0, curkey.data(), 3, 1.0 ) > 0 );
+    }
+    SECTION( "the packed keys compare as the columns do" )
+    {
+      auto  sorter = SortKeys( mtc::array_zmap{
+        { { "field", "author" }, { "order", "desc" } },
+        { { "field", "price" } } }, values );
+
+      for ( uint32_t d1 = 0; d1 < 100; d1 += 7 )
+        for ( uint32_t d2 = 0; d2 < 100; d2 += 3 )
+        {
+          auto  k1 = sorter.GetKeys( d1 );
+          auto  k2 = sorter.GetKeys( d2 );
+
+          REQUIRE( sorter.Compare( k1.data(), d1, 1.0, k2.data(), d2, 2.0 ) == sorter.Compare( d1, 1.0, d2, 2.0 ) );
+        }
+    }
+  }
+} );
@@ -0,0 +1,75 @@
+# include "../../src/service/collect-rerank.hpp"
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <string>
+# include <cmath>
+
+using namespace palmira;
+using namespace palmira::collect;
+
+TestItEasy::RegisterFunc  test_collect_rerank( []()
+{
+  TEST_CASE( "service/collect-rerank" )
+  {
+    auto  dvroot = testing::ValuesDir( "collect-rerank" );
+    auto  values = dvroot.Create( mtc::zmap{
+      { "year",   "int" },
+      { "rating", "double" },
+      { "author", "string" } }, 0x100 );
+
+    values.Set( 1, mtc::zmap{ { "year", 2020 }, { "rating", 4.0 } } );
+    values.Set( 2, mtc::zmap{ { "year", 2000 } } );
+
+    SECTION( "invalid rerank specs are rejected" )
+    {
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "window", 0 } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "window", 20000 } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "proximity", -1.0 } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "boost", mtc::zmap{ { "field", "title" } } } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "boost", mtc::zmap{ { "field", "author" } } } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "boost", mtc::zmap{ { "field", "rating" } } } }, nullptr ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "freshness", mtc::zmap{ { "field", "year" }, { "scale", 10 } } } }, &values ), std::invalid_argument );
+      REQUIRE_EXCEPTION( RerankSpec( mtc::zmap{ { "freshness", mtc::zmap{ { "field", "year" }, { "origin", 2025 } } } }, &values ), std::invalid_argument );
+    }
+    SECTION( "the window is 500 documents by default" )
+    {
+      REQUIRE( RerankSpec( mtc::zmap(), &values ).GetWindow() == 500 );
+      REQUIRE( RerankSpec( mtc::zmap{ { "window", 100 } }, &values ).GetWindow() == 100 );
+    }
+    SECTION( "freshness and boost scale the first phase weight" )
+    {
+      auto      rerank = RerankSpec( mtc::zmap{
+        { "freshness", mtc::zmap{ { "field", "year" }, { "origin", 2020 }, { "scale", 10 }, { "weight", 0.5 } } },
+        { "boost", mtc::zmap{ { "field", "rating" }, { "factor", 0.1 } } } }, &values );
+      Abstract  tuples = {};
+
+      tuples.dwMode = Abstract::BM25;
+
+      REQUIRE( fabs( rerank( 1, 1.0, tuples ) - 1.5 * (1.0 + 0.1 * log( 5.0 )) ) < 1e-12 );
+      REQUIRE( fabs( rerank( 2, 1.0, tuples ) - (1.0 + 0.5 * exp( -2.0 )) ) < 1e-12 );
+      REQUIRE( fabs( rerank( 3, 0.7, tuples ) - 0.7 ) < 1e-12 );
+    }
+    SECTION( "dense entries are preferred by the proximity" )
+    {
+      auto                rerank = RerankSpec( mtc::zmap{ { "proximity", 1.0 } }, &values );
+      Abstract            tuples = {};
+      Abstract::EntrySet  entset = {};
+      Abstract::EntryPos  spread[3] = {};
+
+      entset.limits.uMin = 10;
+      entset.limits.uMax = 15;
+      entset.spread.pbeg = spread;
+      entset.spread.pend = spread + 3;
+
+      tuples.dwMode = Abstract::Rich;
+      tuples.entries.pbeg = &entset;
+      tuples.entries.pend = &entset + 1;
+
+      REQUIRE( fabs( rerank( 3, 1.0, tuples ) - 1.5 ) < 1e-12 );
+
+      entset.spread.pend = spread + 1;
+
+      REQUIRE( fabs( rerank( 3, 1.0, tuples ) - 1.0 ) < 1e-12 );
+    }
+  }
+} );
@@ -0,0 +1,59 @@
+# include "../../src/service/doc-arena.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <vector>
+
+using namespace palmira;
+
+TestItEasy::RegisterFunc  test_doc_arena( []()
+{
+  TEST_CASE( "service/doc-arena" )
+  {
+    SECTION( "the memory is reused by the next documents of the thread" )
+    {
+      void* pfirst;
+
+      if ( true )
+      {
+        auto  arena = DocArena::Lease();
+          pfirst = arena.get_allocator().allocate( 0x100 );
+      }
+      if ( true )
+      {
+        auto  arena = DocArena::Lease();
+
+        REQUIRE( arena.get_allocator().allocate( 0x100 ) == pfirst );
+      }
+    }
+    SECTION( "the initial block grows to fit the documents processed" )
+    {
+      auto  fillup = []()
+        {
+          auto  arena = DocArena::Lease();
+          auto  avalue = std::pmr::vector<char>( arena.get_allocator() );
+
+          for ( int i = 0; i != 0x40000; ++i )
+            avalue.push_back( char(i) );
+        };
+
+      fillup();
+
+      auto  before = DocArena::GetMetrics();
+
+      fillup();
+      fillup();
+
+      auto  after = DocArena::GetMetrics();
+
+      REQUIRE( after.get_word64( "documents", 0 ) == before.get_word64( "documents", 0 ) + 2 );
+      REQUIRE( after.get_word64( "allocations", 0 ) == before.get_word64( "allocations", 0 ) );
+      REQUIRE( after.get_word64( "grown", 0 ) == before.get_word64( "grown", 0 ) );
+    }
+    SECTION( "the nested lease gets it's own memory" )
+    {
+      auto  outer = DocArena::Lease();
+      auto  inner = DocArena::Lease();
+
+      REQUIRE( outer.get_resource() != inner.get_resource() );
+    }
+  }
+} );
@@ -0,0 +1,67 @@
+# include "doc-values-fixture.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <string>
+
+using namespace palmira;
+
+TestItEasy::RegisterFunc  test_doc_values( []()
+{
+  TEST_CASE( "service/doc-values" )
+  {
+    auto  dvroot = testing::ValuesDir( "doc-values" );
+    auto& dvpath = dvroot.GetPath();
+    auto  fields = mtc::zmap{
+      { "year",   "int" },
+      { "price",  "double" },
+      { "author", "string" } };
+
+    SECTION( "values are stored by docid and survive reopening" )
+    {
+      if ( true )
+      {
+        auto  values = DocValues( dvpath, fields, 0x100000 );
+
+        values.Set( 5, mtc::zmap{
+          { "year",   1999 },
+          { "price",  2.5 },
+          { "author", "Dostoevsky Fyodor Mikhailovich" } } );
+        values.Set( 9000, mtc::zmap{
+          { "year",   2001 } } );
+
+        if ( REQUIRE( values.GetColumn( "year" ) != nullptr ) )
+        {
+          REQUIRE( values.GetColumn( "year" )->GetInt( 5 ) == 1999 );
+          REQUIRE( values.GetColumn( "year" )->Has( 9000 ) );
+          REQUIRE( !values.GetColumn( "year" )->Has( 6 ) );
+          REQUIRE( !values.GetColumn( "year" )->Has( 100000 ) );
+        }
+        if ( REQUIRE( values.GetColumn( "price" ) != nullptr ) )
+        {
+          REQUIRE( values.GetColumn( "price" )->GetDouble( 5 ) == 2.5 );
+          REQUIRE( !values.GetColumn( "price" )->Has( 9000 ) );
+        }
+        if ( REQUIRE( values.GetColumn( "author" ) != nullptr ) )
+          REQUIRE( values.GetColumn( "author" )->GetString( 5 ) == "Dostoevsky Fyodo" );
+
+        values.Del( 9000 );
+
+        REQUIRE( !values.GetColumn( "year" )->Has( 9000 ) );
+      }
+      if ( true )
+      {
+        auto  values = DocValues( dvpath, mtc::zmap{ { "year", "int" } }, 0x100000 );
+
+        REQUIRE( values.GetColumn( "price" ) == nullptr );
+        REQUIRE( values.GetColumn( "year" )->GetInt( 5 ) == 1999 );
+      }
+    }
+    SECTION( "stored field type is checked" )
+    {
+      REQUIRE_EXCEPTION( DocValues( dvpath, mtc::zmap{ { "year", "double" } }, 0x100000 ), std::runtime_error );
+    }
+    SECTION( "unknown field type is rejected" )
+    {
+      REQUIRE_EXCEPTION( DocValues( dvpath, mtc::zmap{ { "year", "date" } }, 0x100000 ), std::invalid_argument );
+    }
+  }
+} );
@@ -0,0 +1,72 @@
+# include "../../src/service/executor.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <algorithm>
+# include <atomic>
+# include <chrono>
+
+using namespace palmira;
+
+TestItEasy::RegisterFunc  test_executor( []()
+{
+  TEST_CASE( "service/executor" )
+  {
+    auto  actors = Executor( 4 );
+
+   /*
+    * the task running for a while to let the others start; registers the peak
+    * count of the tasks of the group running simultaneously
+    */
+    auto  runner = []( std::atomic_int& active, std::atomic_int& maxrun )
+      {
+        return [&]()
+          {
+            auto  nactive = ++active;
+            auto  npeaked = maxrun.load();
+
+            while ( nactive > npeaked && !maxrun.compare_exchange_weak( npeaked, nactive ) )
+              (void)0;
+
+            std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+            --active;
+          };
+      };
+
+    SECTION( "the tasks of the group are run by the idle workers in parallel" )
+    {
+      auto  active = std::atomic_int( 0 );
+      auto  maxrun = std::atomic_int( 0 );
+      auto  ntasks = Executor::Tasks( &actors );
+
+    // let the workers fall asleep waiting for the tasks
+      std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+      for ( int i = 0; i != 16; ++i )
+        ntasks.Insert( runner( active, maxrun ) );
+
+      ntasks.Wait();
+
+      REQUIRE( maxrun.load() > 2 );
+    }
+    SECTION( "the group limit holds for the waiting thread too" )
+    {
+      auto  active = std::atomic_int( 0 );
+      auto  maxrun = std::atomic_int( 0 );
+      auto  ntasks = Executor::Tasks( &actors, 2 );
+
+      for ( int i = 0; i != 16; ++i )
+        ntasks.Insert( runner( active, maxrun ) );
+
+      ntasks.Wait();
+
+      REQUIRE( maxrun.load() == 2 );
+    }
+    SECTION( "the first exception is rethrown by Wait()" )
+    {
+      auto  ntasks = Executor::Tasks( &actors );
+
+      ntasks.Insert( [](){  throw std::runtime_error( "task failed" );  } );
+
+      REQUIRE_EXCEPTION( ntasks.Wait(), std::runtime_error );
+    }
+  }
+} );
@@ -0,0 +1,118 @@
+# include "../../src/service/search-cache.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <string>
+
+using namespace palmira;
+
+namespace {
+
+  auto  MakeKey( const mtc::zmap& order ) -> std::string
+  {
+    return SearchCache::MakeKey( SearchArgs( "palmira", order ) );
+  }
+
+  auto  MakeReport( uint32_t found ) -> mtc::zmap
+  {
+    return mtc::zmap{ { "found", found } };
+  }
+
+}
+
+TestItEasy::RegisterFunc  test_search_cache( []()
+{
+  TEST_CASE( "service/search-cache" )
+  {
+    SECTION( "the keys ignore the arguments not affecting the results" )
+    {
+      auto  search = MakeKey( {} );
+
+      REQUIRE( MakeKey( { { "first", 1 }, { "count", 10 } } ) == search );
+      REQUIRE( MakeKey( { { "threads", 4 }, { "quote_timeout", 0.1 }, { "profile", true } } ) == search );
+      REQUIRE( MakeKey( { { "count", 20 } } ) != search );
+      REQUIRE( MakeKey( { { "after", "01" } } ) != search );
+      REQUIRE( SearchCache::MakeKey( SearchArgs( "tripoli" ) ) != search );
+    }
+    SECTION( "the least recently used reports are evicted by the memory limit" )
+    {
+      auto  report = mtc::zmap();
+      auto  length = size_t(0);
+
+    // get the memory used by the single report; the keys and the reports have equal lengths
+      {
+        auto  sample = SearchCache( 0x10000 );
+
+        sample.Put( MakeKey( { { "count", 11 } } ), 1, MakeReport( 11 ) );
+        length = sample.GetMetrics().get_word64( "memory", 0 );
+      }
+
+      if ( REQUIRE( length != 0 ) )
+      {
+        auto  search = SearchCache( length * 3 + length / 2 );
+
+        for ( auto count: { 11, 12, 13 } )
+          search.Put( MakeKey( { { "count", count } } ), 1, MakeReport( count ) );
+
+        REQUIRE( search.Get( MakeKey( { { "count", 11 } } ), 1, report ) );
+
+        search.Put( MakeKey( { { "count", 14 } } ), 1, MakeReport( 14 ) );
+
+        REQUIRE( !search.Get( MakeKey( { { "count", 12 } } ), 1, report ) );
+
+        for ( auto count: { 11, 13, 14 } )
+        {
+          if ( REQUIRE( search.Get( MakeKey( { { "count", count } } ), 1, report ) ) )
+            REQUIRE( report.get_word32( "found", 0 ) == uint32_t(count) );
+        }
+
+        REQUIRE( search.GetMetrics().get_word32( "items", 0 ) == 3 );
+        REQUIRE( search.GetMetrics().get_word64( "memory", 0 ) <= length * 3 + length / 2 );
+      }
+    }
+    SECTION( "the reports count is limited" )
+    {
+      auto  search = SearchCache( 0x100000, 2 );
+      auto  report = mtc::zmap();
+
+      for ( auto count: { 11, 12, 13 } )
+        search.Put( MakeKey( { { "count", count } } ), 1, MakeReport( count ) );
+
+      REQUIRE( !search.Get( MakeKey( { { "count", 11 } } ), 1, report ) );
+      REQUIRE( search.Get( MakeKey( { { "count", 12 } } ), 1, report ) );
+      REQUIRE( search.Get( MakeKey( { { "count", 13 } } ), 1, report ) );
+    }
+    SECTION( "the index generation change resets the cache" )
+    {
+      auto  search = SearchCache( 0x100000 );
+      auto  report = mtc::zmap();
+      auto  keystr = MakeKey( {} );
+
+      search.Put( keystr, 1, MakeReport( 1 ) );
+
+      REQUIRE( search.Get( keystr, 1, report ) );
+      REQUIRE( !search.Get( keystr, 2, report ) );
+      REQUIRE( search.GetMetrics().get_word32( "items", 0 ) == 0 );
+    }
+    SECTION( "the report of the outdated index is never served after an insert" )
+    {
+      auto  search = SearchCache( 0x100000 );
+      auto  report = mtc::zmap();
+      auto  keystr = MakeKey( {} );
+
+    // the search started before the insert finishes after the newer one
+      REQUIRE( !search.Get( keystr, 1, report ) );
+      REQUIRE( !search.Get( keystr, 2, report ) );
+
+      search.Put( keystr, 1, MakeReport( 1 ) );
+
+      REQUIRE( !search.Get( keystr, 2, report ) );
+
+      search.Put( keystr, 2, MakeReport( 2 ) );
+
+    // the late search on the outdated index does not reset the newer reports
+      REQUIRE( !search.Get( keystr, 1, report ) );
+
+      if ( REQUIRE( search.Get( keystr, 2, report ) ) )
+        REQUIRE( report.get_word32( "found", 0 ) == 2 );
+    }
+  }
+} );
@@ -0,0 +1,46 @@
+# include "../../src/service/search-stats.hpp"
+# include <mtc/test-it-easy.hpp>
+
+using namespace palmira;
+
+TestItEasy::RegisterFunc  test_search_stats( []()
+{
+  TEST_CASE( "service/search-stats" )
+  {
+    SECTION( "no phases are reported before the durations are added" )
+    {
+      auto  sstats = SearchStats();
+
+      REQUIRE( sstats.GetMetrics().empty() );
+    }
+    SECTION( "durations are counted by log2 buckets" )
+    {
+      auto  sstats = SearchStats();
+
+      for ( uint64_t us = 1; us <= 100; ++us )
+        sstats.Add( SearchStats::Search, us );
+
+      sstats.Add( SearchStats::Total, 5000 );
+
+      auto  output = sstats.GetMetrics();
+      auto  search = output.get_zmap( "search" );
+      auto  totals = output.get_zmap( "total" );
+
+      REQUIRE( output.get_zmap( "build" ) == nullptr );
+
+      if ( REQUIRE( search != nullptr ) )
+      {
+        REQUIRE( search->get_word64( "count", 0 ) == 100 );
+        REQUIRE( search->get_word64( "mean_us", 0 ) == 50 );
+        REQUIRE( search->get_word64( "p50_us", 0 ) == 64 );
+        REQUIRE( search->get_word64( "p99_us", 0 ) == 128 );
+        REQUIRE( search->get_word64( "max_us", 0 ) == 100 );
+      }
+      if ( REQUIRE( totals != nullptr ) )
+      {
+        REQUIRE( totals->get_word64( "count", 0 ) == 1 );
+        REQUIRE( totals->get_word64( "p50_us", 0 ) == 8192 );
+      }
+    }
+  }
+} );
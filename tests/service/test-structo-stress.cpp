@@ -0,0 +1,258 @@
+# include "../../service/structo-search.hpp"
+# include "../../src/service/executor.hpp"
+# include "../../src/service/doc-values.hpp"
+# include <structo/indexer/layered-contents.hpp>
+# include <structo/storage/posix-fs.hpp>
+# include <structo/queries/parser.hpp>
+# include <mtc/test-it-easy.hpp>
+# include <unistd.h>
+# include <filesystem>
+# include <atomic>
+# include <thread>
+
+using namespace palmira;
+
+namespace {
+
+  auto  MakeService( const std::string& ixpath ) -> mtc::api<IService>
+  {
+    return StructoService()
+      .Set( structo::indexer::layered::Index(
+        Open( structo::storage::posixFS::StoragePolicies::Open( ixpath ) ) ).Create() )
+      .Set( structo::context::GetRichContents )
+      .Set( structo::context::Processor() )
+      .Set( std::make_shared<Executor>( 4 ) )
+      .Create();
+  }
+
+  auto  MakeService( const std::string& ixpath, std::shared_ptr<DocValues> values ) -> mtc::api<IService>
+  {
+    return StructoService()
+      .Set( structo::indexer::layered::Index(
+        Open( structo::storage::posixFS::StoragePolicies::Open( ixpath ) ) ).Create() )
+      .Set( structo::context::GetRichContents )
+      .Set( structo::context::Processor() )
+      .Set( std::make_shared<Executor>( 4 ) )
+      .Set( values )
+      .Create();
+  }
+
+  auto  MakeText( unsigned index ) -> DeliriX::Text
+  {
+    auto  intext = DeliriX::Text();
+
+    intext.AddBlock( mtc::strprintf( "common text number%u word%u", index, index % 7 ).c_str() );
+    intext.AddBlock( "the second paragraph of the common document" );
+    return intext;
+  }
+
+  auto  GetCode( const mtc::zmap& report ) -> int32_t
+  {
+    return report.get_zmap( "status", {} ).get_int32( "code", -1 );
+  }
+
+  auto  Search( IService* service, const char* query ) -> mtc::zmap
+  {
+    return service->Search( SearchArgs( structo::queries::ParseQuery( query ), {
+      { "first", int32_t(1) },
+      { "count", int32_t(10) } } ) )->Wait();
+  }
+
+  auto  GetIds( const mtc::zmap& report ) -> std::vector<std::string>
+  {
+    auto  output = std::vector<std::string>();
+
+    if ( report.get_array_zmap( "items" ) != nullptr )
+      for ( auto& next: *report.get_array_zmap( "items" ) )
+        output.push_back( next.get_charstr( "id", "" ) );
+
+    return output;
+  }
+
+}
+
+TestItEasy::RegisterFunc  test_structo_stress( []()
+{
+  TEST_CASE( "service/structo-search" )
+  {
+    char  tmpdir[] = "/tmp/palmira-stress-XXXXXX";
+
+    if ( !REQUIRE( mkdtemp( tmpdir ) != nullptr ) )
+      return;
+
+    SECTION( "mixed inserts, removes, commits and searches run concurrently" )
+    {
+      const unsigned  nwriters = 3;
+      const unsigned  ndocs = 200;
+
+      auto  service = MakeService( std::string( tmpdir ) + "/index" );
+      auto  threads = std::vector<std::thread>();
+      auto  writing = std::atomic_uint( nwriters + 1 );
+      auto  ninsert = std::atomic_uint( 0 );
+      auto  nremove = std::atomic_uint( 0 );
+      auto  nfailed = std::atomic_uint( 0 );
+
+    // the single document writers, each removing every fifth document inserted
+      for ( unsigned w = 0; w != nwriters; ++w )
+      {
+        threads.emplace_back( [&, w]()
+        {
+          for ( unsigned i = 0; i != ndocs; ++i )
+          {
+            auto  docid = mtc::strprintf( "doc-%u-%u", w, i );
+            auto  intext = MakeText( i );
+
+            if ( GetCode( service->Insert( InsertArgs( docid, intext ) )->Wait() ) == 0 ) ++ninsert;
+              else ++nfailed;
+
+            if ( i % 5 == 0 && GetCode( service->Remove( RemoveArgs( docid ) )->Wait() ) == 0 )
+              ++nremove;
+          }
+          --writing;
+        } );
+      }
+
+    // the bulk writer
+      threads.emplace_back( [&]()
+      {
+        for ( unsigned b = 0; b != 4; ++b )
+        {
+          auto  inbulk = BulkArgs();
+          auto  output = mtc::zmap();
+
+          for ( unsigned i = 0; i != 50; ++i )
+            inbulk.insert.emplace_back( mtc::zmap{
+              { "id", mtc::strprintf( "bulk-%u-%u", b, i ) },
+              { "json", "[\"common bulk document\"]" } } );
+
+          output = service->BulkInsert( inbulk )->Wait();
+
+          if ( output.get_word32( "failed", 1 ) == 0 ) ninsert += 50;
+            else ++nfailed;
+        }
+        --writing;
+      } );
+
+    // the committer
+      threads.emplace_back( [&]()
+      {
+        while ( writing != 0 )
+        {
+          service->Commit();
+          std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+        }
+      } );
+
+    // the readers
+      for ( unsigned r = 0; r != 4; ++r )
+      {
+        threads.emplace_back( [&, r]()
+        {
+          while ( writing != 0 )
+          {
+            auto  report = Search( service.ptr(), r % 2 == 0 ? "common" : "second paragraph" );
+
+            if ( GetCode( report ) != 0 )
+              ++nfailed;
+
+            report = service->Search( SearchArgs( mtc::zmap{ { "id", "doc-0-1" } } ) )->Wait();
+
+            if ( GetCode( report ) != 0 && GetCode( report ) != ENOENT )
+              ++nfailed;
+          }
+        } );
+      }
+
+      for ( auto& next: threads )
+        next.join();
+
+      service->Commit();
+
+      REQUIRE( nfailed == 0 );
+      REQUIRE( Search( service.ptr(), "common" ).get_word32( "found", 0 ) == ninsert - nremove );
+    }
+
+    SECTION( "grouped documents on the page are quoted" )
+    {
+      auto  values = std::make_shared<DocValues>( std::string( tmpdir ) + "/values", mtc::zmap{
+        { "author", "string" } }, 0x1000 );
+      auto  service = MakeService( std::string( tmpdir ) + "/grouped", values );
+      auto  report = mtc::zmap();
+      auto  nitems = 0U;
+      auto  quoted = 0U;
+
+      for ( unsigned i = 0; i != 40; ++i )
+      {
+        service->Insert( InsertArgs( mtc::strprintf( "doc-%u", i ), MakeText( i ), {
+          { "author", mtc::strprintf( "author-%u", i % 4 ) } } ) )->Wait();
+      }
+
+      service->Commit();
+
+    // the page of 4 groups of 3 documents each lists more documents than the count
+      report = service->Search( SearchArgs( structo::queries::ParseQuery( "common" ), {
+        { "count",      int32_t(10) },
+        { "group_by",   "author" },
+        { "group_size", int32_t(3) } } ) )->Wait();
+
+      REQUIRE( GetCode( report ) == 0 );
+
+      if ( REQUIRE( report.get_array_zmap( "groups" ) != nullptr ) )
+      {
+        REQUIRE( report.get_array_zmap( "groups" )->size() == 4U );
+
+        for ( auto& group: *report.get_array_zmap( "groups" ) )
+          if ( group.get_array_zmap( "items" ) != nullptr )
+            for ( auto& item: *group.get_array_zmap( "items" ) )
+              nitems += 1, quoted += item.get( "quote" ) != nullptr ? 1 : 0;
+
+        REQUIRE( nitems == 12U );
+        REQUIRE( quoted == nitems );
+      }
+    }
+
+    SECTION( "the batch searches are run independently" )
+    {
+      auto  service = MakeService( std::string( tmpdir ) + "/msearch" );
+      auto  common = SearchArgs( structo::queries::ParseQuery( "common" ), { { "count", int32_t(5) } } );
+      auto  number = SearchArgs( structo::queries::ParseQuery( "word3" ), { { "count", int32_t(5) } } );
+      auto  broken = SearchArgs( structo::queries::ParseQuery( "common" ), { { "after", "zz" } } );
+      auto  report = mtc::zmap();
+      auto  output = (const mtc::array_zmap*)nullptr;
+
+      for ( unsigned i = 0; i != 40; ++i )
+        service->Insert( InsertArgs( mtc::strprintf( "doc-%u", i ), MakeText( i ) ) )->Wait();
+
+      service->Commit();
+
+      report = service->MSearch( MSearchArgs( { common, number, broken, common, number } ) )->Wait();
+      output = report.get_array_zmap( "reports" );
+
+      REQUIRE( GetCode( report ) == 0 );
+
+      if ( REQUIRE( output != nullptr ) && REQUIRE( output->size() == 5U ) )
+      {
+      // the failed search does not break the others
+        REQUIRE( GetCode( output->at( 2 ) ) == EINVAL );
+
+      // the equal searches report the same as the single ones
+        for ( auto& single: { std::make_pair( 0, common ), std::make_pair( 1, number ) } )
+        {
+          auto  sample = service->Search( single.second )->Wait();
+          auto& listed = output->at( single.first );
+          auto& repeat = output->at( single.first + 3 );
+
+          REQUIRE( GetCode( listed ) == 0 );
+          REQUIRE( GetCode( repeat ) == 0 );
+          REQUIRE( listed.get_word32( "found", 0 ) == sample.get_word32( "found", 1 ) );
+          REQUIRE( repeat.get_word32( "found", 0 ) == sample.get_word32( "found", 1 ) );
+          REQUIRE( !GetIds( listed ).empty() );
+          REQUIRE( GetIds( listed ) == GetIds( sample ) );
+          REQUIRE( GetIds( repeat ) == GetIds( sample ) );
+        }
+      }
+    }
+
+    std::filesystem::remove_all( tmpdir );
+  }
+} );
@@ -0,0 +1,102 @@
+# include "../../src/service/top-docs.hpp"
+# include <mtc/test-it-easy.hpp>
+# include <algorithm>
+# include <random>
+# include <vector>
+
+using namespace palmira::collect;
+
+static int  CompareByRange( uint32_t d1, double f1, uint32_t d2, double f2 )
+{
+  int   res = (f1 < f2) - (f1 > f2);
+  return res != 0 ? res : (d1 > d2) - (d1 < d2);
+}
+
+TestItEasy::RegisterFunc  test_top_docs( []()
+{
+  TEST_CASE( "service/top-docs" )
+  {
+    auto  random = std::mt19937( 17 );
+    auto  weight = std::vector<double>( 100000 );
+
+    for ( auto& next: weight )
+      next = std::uniform_int_distribution<int>( 0, 1000 )( random ) / 1000.0;
+
+    SECTION( "top documents are selected and ordered from the best to the worst" )
+    {
+      for ( auto limit: { 1U, 10U, 100U, 1000U } )
+      {
+        auto  docids = std::vector<uint32_t>( limit );
+        auto  values = std::vector<double>( limit );
+        auto  topdoc = TopDocs<decltype(&CompareByRange)>( docids.data(), values.data(), limit, &CompareByRange );
+        auto  sorted = std::vector<std::pair<uint32_t, double>>();
+
+        for ( uint32_t id = 0; id != weight.size(); ++id )
+        {
+          sorted.push_back( { id, weight[id] } );
+
+          if ( topdoc.Accept( id, weight[id] ) )
+            topdoc.Insert( id, weight[id] );
+        }
+
+        std::sort( sorted.begin(), sorted.end(), []( const std::pair<uint32_t, double>& l, const std::pair<uint32_t, double>& r )
+          {  return CompareByRange( l.first, l.second, r.first, r.second ) < 0;  } );
+
+        topdoc.Sort();
+
+        if ( REQUIRE( topdoc.size() == limit ) )
+          for ( unsigned i = 0; i != limit; ++i )
+            if ( !REQUIRE( topdoc.GetIds()[i] == sorted[i].first ) )
+              break;
+      }
+    }
+    SECTION( "documents are ordered by the packed keys, then by the differ" )
+    {
+      auto  limit = 100U;
+      auto  docids = std::vector<uint32_t>( limit );
+      auto  values = std::vector<double>( limit );
+      auto  keyset = std::vector<uint64_t>( (limit + 1) * 2 );
+      auto  topdoc = TopDocs<decltype(&CompareByRange)>( docids.data(), values.data(), limit, &CompareByRange, keyset.data(), 2 );
+      auto  sorted = std::vector<std::pair<uint32_t, double>>();
+      auto  getkey = []( uint32_t id ) -> std::vector<uint64_t>
+        {  return { id % 7, ~uint64_t(id % 3) };  };
+
+      for ( uint32_t id = 0; id != 10000; ++id )
+      {
+        auto  keys = getkey( id );
+
+        sorted.push_back( { id, weight[id] } );
+
+        if ( topdoc.Accept( id, weight[id], keys.data() ) )
+          topdoc.Insert( id, weight[id], keys.data() );
+      }
+
+      std::sort( sorted.begin(), sorted.end(), [&]( const std::pair<uint32_t, double>& l, const std::pair<uint32_t, double>& r )
+        {
+          auto  kl = getkey( l.first );
+          auto  kr = getkey( r.first );
+
+          return kl != kr ? kl < kr : CompareByRange( l.first, l.second, r.first, r.second ) < 0;
+        } );
+
+      topdoc.Sort();
+
+      if ( REQUIRE( topdoc.size() == limit ) )
+        for ( unsigned i = 0; i != limit; ++i )
+          if ( !REQUIRE( topdoc.GetIds()[i] == sorted[i].first && getkey( sorted[i].first )[1] == topdoc.GetKeys( i )[1] ) )
+            break;
+    }
+    SECTION( "evicted document is reported by Insert()" )
+    {
+      uint32_t  docids[2];
+      double    values[2];
+      auto      topdoc = TopDocs<decltype(&CompareByRange)>( docids, values, 2, &CompareByRange );
+
+      REQUIRE( topdoc.Insert( 1, 0.5 ) == uint32_t(-1) );
+      REQUIRE( topdoc.Insert( 2, 0.7 ) == uint32_t(-1) );
+      REQUIRE( !topdoc.Accept( 3, 0.1 ) );
+      REQUIRE( topdoc.Accept( 4, 0.9 ) );
+      REQUIRE( topdoc.Insert( 4, 0.9 ) == 1 );
+    }
+  }
+} );
@@ -0,0 +1,114 @@
+# include <service/structo-search.hpp>
+# include <structo/queries/parser.hpp>
+# include <mtc/config.h>
+# include <mtc/json.h>
+# include <algorithm>
+# include <chrono>
+# include <string>
+# include <vector>
+# include <thread>
+
+/*
+ * search-bench config.name queries.txt [max-threads [repeat]]
+ *
+ * Runs the queries listed in the text file (one query per line) against the local
+ * service and prints p50/p99 latencies for the per-query parallelism growing from
+ * 1 to max-threads.  The 'executor' section of the service config has to provide
+ * at least max-threads worker threads.  The timed searches are profiled, so they
+ * bypass the search results cache even if the config enables it.
+ */
+
+auto  LoadQueries( const char* path ) -> std::vector<mtc::zval>
+{
+  auto  queries = std::vector<mtc::zval>();
+  auto  infile = fopen( path, "rt" );
+  char  buffer[0x1000];
+
+  if ( infile == nullptr )
+    throw std::runtime_error( mtc::strprintf( "could not open file '%s'", path ) );
+
+  while ( fgets( buffer, sizeof(buffer), infile ) != nullptr )
+  {
+    auto  strlen = std::string( buffer );
+
+    while ( !strlen.empty() && (unsigned char)strlen.back() <= 0x20 )
+      strlen.pop_back();
+
+    if ( !strlen.empty() )
+      queries.push_back( structo::queries::ParseQuery( strlen ) );
+  }
+  fclose( infile );
+
+  return queries;
+}
+
+auto  Percentile( const std::vector<double>& sorted, unsigned pc ) -> double
+{
+  return sorted.empty() ? 0.0 : sorted[std::min( sorted.size() - 1, sorted.size() * pc / 100 )];
+}
+
+int   main( int argc, char* argv[] )
+{
+  auto  search = mtc::api<palmira::IService>();
+  auto  config = mtc::config();
+  auto  querys = std::vector<mtc::zval>();
+  auto  maxthr = unsigned(std::thread::hardware_concurrency());
+  auto  repeat = 3U;
+
+  if ( argc < 3 )
+    return fprintf( stdout, "Usage: %s config.name queries.txt [max-threads [repeat]]\n", argv[0] ), EINVAL;
+
+  if ( argc > 3 && (maxthr = strtoul( argv[3], nullptr, 10 )) == 0 )
+    return fprintf( stderr, "invalid threads count '%s'\n", argv[3] ), EINVAL;
+
+  if ( argc > 4 && (repeat = strtoul( argv[4], nullptr, 10 )) == 0 )
+    return fprintf( stderr, "invalid repeat count '%s'\n", argv[4] ), EINVAL;
+
+  try
+  {
+    config = config.Open( argv[1] );
+    querys = LoadQueries( argv[2] );
+
+    if ( (search = palmira::CreateStructo( config.get_section( "service" ) )) == nullptr )
+      throw std::logic_error( "unexpected CreateStructo(...) result 'nullptr'" );
+  }
+  catch ( const mtc::json::parse::error& xp )
+    {  return fprintf( stderr, "Error parsing config '%s', line %d: %s\n", argv[1], xp.get_json_lineid(), xp.what() ), EINVAL;  }
+  catch ( const std::exception& xp )
+    {  return fprintf( stderr, "%s\n", xp.what() ), EINVAL;  }
+
+// warm up the index pages
+  for ( auto& query: querys )
+    search->Search( { query } )->Wait();
+
+  for ( unsigned nthreads = 1; ; nthreads = std::min( nthreads * 2, maxthr ) )
+  {
+    auto  timing = std::vector<double>();
+    auto  ordArg = mtc::zmap{
+      { "first",   1 },
+      { "count",   10 },
+      { "threads", int32_t(nthreads) },
+      { "profile", true } };      // the profiled searches are never cached
+
+    for ( unsigned i = 0; i != repeat; ++i )
+      for ( auto& query: querys )
+      {
+        auto  tstart = std::chrono::steady_clock::now();
+
+        search->Search( { query, ordArg } )->Wait();
+
+        timing.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - tstart ).count() );
+      }
+
+    std::sort( timing.begin(), timing.end() );
+
+    fprintf( stdout, "%3u threads: p50 %9.3f ms, p99 %9.3f ms\n", nthreads,
+      Percentile( timing, 50 ),
+      Percentile( timing, 99 ) );
+
+    if ( nthreads == maxthr )
+      break;
+  }
+
+  return 0;
+}